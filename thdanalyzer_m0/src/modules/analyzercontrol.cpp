@@ -16,6 +16,7 @@ void vAnalyzerControlTask(void* pvParameters)
 	while(1) {
 		analyzercontrol.Update();
 
+		// the M4 event is the M0 tick, so acks are polled once per tick
 		vTaskDelay(1);
 	}
 }
@@ -24,6 +25,8 @@ void AnalyzerControl::StartTask()
 {
 	_semaphore = xSemaphoreCreateCounting(1, 1);
 	_needconfiguration = false;
+	_pendingacks = 0;
+	_newack = false;
 	_needanalysis = 0;
 	_analysiscomplete = false;
 
@@ -34,27 +37,20 @@ void AnalyzerControl::Update()
 {
 	AnalysisState prevstate = _analysisstate;
 	do {
-		switch (_configurationstate) {
-		case ConfigurationIdle:
-			if (_needconfiguration) {
-				RequestConfigure();
-				_configurationstate = ConfigurationUpload;
-				break;
-			}
-			break;
-		case ConfigurationUpload:
-			if (ConfigurationReady()) {
-				_configurationstate = ConfigurationIdle;
-			}
-			break;
+		// a new configuration goes out without waiting for the acks of
+		// earlier ones, as long as the queues hold it and its ack
+		while (ConfigurationReady()) {
+			_pendingacks--;
+		}
+		if (_needconfiguration && _pendingacks < commandMailbox.Slots() && RequestConfigure()) {
+			_pendingacks++;
 		}
 
 		prevstate = _analysisstate;
 
 		switch (_analysisstate) {
 		case StateIdle:
-			if (_needanalysis > 0) {
-				RequestAnalyze();
+			if (_needanalysis > 0 && RequestAnalyze()) {
 				_analysisstate = StateAnalysisRunning;
 				break;
 			}
@@ -66,8 +62,7 @@ void AnalyzerControl::Update()
 			}
 			break;
 		case StateAnalysisProcessing:
-			if (_analysiscomplete) {
-				ReleaseAnalyzer();
+			if (_analysiscomplete && ReleaseAnalyzer()) {
 				_analysisstate = StateAnalysisReleasing;
 			}
 			break;
@@ -80,25 +75,37 @@ void AnalyzerControl::Update()
 	} while (_analysisstate != prevstate);
 }
 
-void AnalyzerControl::RequestConfigure()
+// The queue writes below never wait, a full queue is tried again on the
+// next update
+bool AnalyzerControl::RequestConfigure()
 {
 	taskENTER_CRITICAL();
 
-	_needconfiguration = false;
-	commandMailbox.Write(_configuration);
+	bool result = commandMailbox.Write(_configuration);
+	if (result) {
+		_needconfiguration = false;
+		NotifyAnalyzer();
+	}
 
 	taskEXIT_CRITICAL();
+
+	return result;
 }
 
-void AnalyzerControl::RequestAnalyze()
+bool AnalyzerControl::RequestAnalyze()
 {
 	taskENTER_CRITICAL();
 
 	AnalysisCommand cmd;
 	cmd.commandType = AnalysisCommand::BLOCK;
-	analysisCommandMailbox.Write(cmd);
+	bool result = analysisCommandMailbox.Write(cmd);
+	if (result) {
+		NotifyAnalyzer();
+	}
 
 	taskEXIT_CRITICAL();
+
+	return result;
 }
 
 bool AnalyzerControl::AnalyzerCommandReady()
@@ -111,34 +118,68 @@ bool AnalyzerControl::AnalyzerCommandReady()
 	return true;
 }
 
+// Wake the M4 for the mailbox just written, a new configuration also
+// cancels the analysis it is running
+void AnalyzerControl::NotifyAnalyzer()
+{
+	__DSB();
+	__SEV();
+}
+
 void AnalyzerControl::WakeAnalysisRequest()
 {
 	xSemaphoreGive(_semaphore);
 }
 
-void AnalyzerControl::ReleaseAnalyzer()
+bool AnalyzerControl::ReleaseAnalyzer()
 {
 	taskENTER_CRITICAL();
 
 	AnalysisCommand cmd;
 	cmd.commandType = AnalysisCommand::DONE;
-	analysisCommandMailbox.Write(cmd);
-
-	_analysiscomplete = false;
+	bool result = analysisCommandMailbox.Write(cmd);
+	if (result) {
+		NotifyAnalyzer();
+		_analysiscomplete = false;
+	}
 
 	taskEXIT_CRITICAL();
+
+	return result;
 }
 
 bool AnalyzerControl::ConfigurationReady()
 {
-	if (commandMailbox.CanWrite()) {
-		ackMailbox.Read();
+	GeneratorAck ack;
+	if (ackMailbox.Read(ack)) {
+		taskENTER_CRITICAL();
+
+		_ack = ack;
+		_newack = true;
+
+		taskEXIT_CRITICAL();
 		return true;
 	}
 
 	return false;
 }
 
+// The generator frequency the M4 settled on, once per configuration
+bool AnalyzerControl::ConfigurationAck(GeneratorAck& ack)
+{
+	taskENTER_CRITICAL();
+
+	bool result = _newack;
+	if (result) {
+		ack = _ack;
+		_newack = false;
+	}
+
+	taskEXIT_CRITICAL();
+
+	return result;
+}
+
 void AnalyzerControl::AnalysisStart()
 {
 	taskENTER_CRITICAL();
@@ -186,11 +227,5 @@ void AnalyzerControl::SetConfiguration(const GeneratorParameters& params)
 	_configuration = params;
 	_needconfiguration = true;
 
-	// Interrupt M4 core if it's analyzing
-	if (StateAnalysisRunning) {
-		__DSB();
-		__SEV();
-	}
-
 	taskEXIT_CRITICAL();
 }
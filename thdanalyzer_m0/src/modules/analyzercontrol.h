@@ -15,20 +15,18 @@ public:
 	void AnalysisRead();
 
 	void SetConfiguration(const GeneratorParameters& params);
+	bool ConfigurationAck(GeneratorAck& ack);
 
 	void Update();
 private:
-	void RequestConfigure();
-	void RequestAnalyze();
+	bool RequestConfigure();
+	bool RequestAnalyze();
 	bool AnalyzerCommandReady();
+	void NotifyAnalyzer();
 	void WakeAnalysisRequest();
-	void ReleaseAnalyzer();
+	bool ReleaseAnalyzer();
 	bool ConfigurationReady();
 
-	enum ConfigurationState {
-		ConfigurationIdle,
-		ConfigurationUpload
-	};
 	enum AnalysisState {
 		StateIdle,
 		StateAnalysisRunning,
@@ -37,10 +35,13 @@ private:
 	};
 
 	AnalysisState _analysisstate;
-	ConfigurationState _configurationstate;
 
 	bool _needconfiguration;
 	GeneratorParameters _configuration;
+	// configurations sent and not acked yet
+	int _pendingacks;
+	bool _newack;
+	GeneratorAck _ack;
 
 	int _needanalysis;
 	bool _analysiscomplete;
@@ -5,6 +5,9 @@
 #include "cgi/StreamDumpCgiHandler.h"
 #include "cgi/GeneratorParameterCgiHandler.h"
 #include "cgi/AnalysisCgiHandler.h"
+#include "cgi/ResultCgiHandler.h"
+#include "cgi/LoadCgiHandler.h"
+#include "cgi/ResponseCgiHandler.h"
 #include "CgiCallback.h"
 
 uint8_t res[2048];
@@ -75,6 +78,9 @@ public:
 		ResEntry* memdumpEntry = AllocEntry(dirsize, RES_TYPE_CGI, "memory.raw");
 		ResEntry* streamEntry = AllocEntry(dirsize, RES_TYPE_CGI, "stream.raw");
 		ResEntry* analysisEntry = AllocEntry(dirsize, RES_TYPE_CGI, "analysis.raw");
+		ResEntry* resultEntry = AllocEntry(dirsize, RES_TYPE_CGI, "result.raw");
+		ResEntry* loadEntry = AllocEntry(dirsize, RES_TYPE_CGI, "load.raw");
+		ResEntry* responseEntry = AllocEntry(dirsize, RES_TYPE_CGI, "response.raw");
 		ResEntry* genEntry = AllocEntry(dirsize, RES_TYPE_CGI, "gen");
 		rootHeader->rootEntry.dataStart = ResOffset(indexEntry);
 		rootHeader->rootEntry.dataLength = dirsize;
@@ -83,11 +89,17 @@ public:
 		AllocDataString(memdumpEntry, "<!--#execcgi=memory.raw-->");
 		AllocDataString(streamEntry, "<!--#execcgi=stream.raw-->");
 		AllocDataString(analysisEntry, "<!--#execcgi=analysis.raw-->");
+		AllocDataString(resultEntry, "<!--#execcgi=result.raw-->");
+		AllocDataString(loadEntry, "<!--#execcgi=load.raw-->");
+		AllocDataString(responseEntry, "<!--#execcgi=response.raw-->");
 		AllocDataString(genEntry, "<!--#execcgi=gen-->");
 
 		SetCgiHandler("memory.raw", _memdump);
 		SetCgiHandler("stream.raw", _stream);
 		SetCgiHandler("analysis.raw", _analysis);
+		SetCgiHandler("result.raw", _result);
+		SetCgiHandler("load.raw", _load);
+		SetCgiHandler("response.raw", _response);
 		SetCgiHandler("gen", _genparam);
 	}
 
@@ -96,6 +108,9 @@ private:
 	StreamDumpCgiHandler _stream;
 	GeneratorParameterCgiHandler _genparam;
 	AnalysisCgiHandler _analysis;
+	ResultCgiHandler _result;
+	LoadCgiHandler _load;
+	ResponseCgiHandler _response;
 };
 
 static HttpResourceManager httpResources;
@@ -10,7 +10,20 @@ enum ParameterId
 {
 	UNKNOWN = 0,
 	FREQUENCY,
-	LEVEL
+	LEVEL,
+	AVERAGING,
+	AVERAGES,
+	OVERLAP,
+	WINDOW,
+	ZOOM,
+	SAMPLERATE,
+	MODE,
+	COHERENT,
+	RBW,
+	NOISEFLOOR,
+	MAXFFTSIZE,
+	PROGRESSIVE,
+	FOURSTEP
 };
 
 ParameterId ParseRequest(const char* request_uri)
@@ -23,6 +36,58 @@ ParameterId ParseRequest(const char* request_uri)
 		return LEVEL;
 	}
 
+	if (!strcmp(request_uri, "/gen/averaging")) {
+		return AVERAGING;
+	}
+
+	if (!strcmp(request_uri, "/gen/averages")) {
+		return AVERAGES;
+	}
+
+	if (!strcmp(request_uri, "/gen/overlap")) {
+		return OVERLAP;
+	}
+
+	if (!strcmp(request_uri, "/gen/window")) {
+		return WINDOW;
+	}
+
+	if (!strcmp(request_uri, "/gen/zoom")) {
+		return ZOOM;
+	}
+
+	if (!strcmp(request_uri, "/gen/samplerate")) {
+		return SAMPLERATE;
+	}
+
+	if (!strcmp(request_uri, "/gen/mode")) {
+		return MODE;
+	}
+
+	if (!strcmp(request_uri, "/gen/coherent")) {
+		return COHERENT;
+	}
+
+	if (!strcmp(request_uri, "/gen/rbw")) {
+		return RBW;
+	}
+
+	if (!strcmp(request_uri, "/gen/noisefloor")) {
+		return NOISEFLOOR;
+	}
+
+	if (!strcmp(request_uri, "/gen/maxfftsize")) {
+		return MAXFFTSIZE;
+	}
+
+	if (!strcmp(request_uri, "/gen/progressive")) {
+		return PROGRESSIVE;
+	}
+
+	if (!strcmp(request_uri, "/gen/fourstep")) {
+		return FOURSTEP;
+	}
+
 	return UNKNOWN;
 }
 
@@ -126,6 +191,185 @@ error_t GeneratorParameterCgiHandler::Request(HttpConnection *connection)
 		n = snprintf(reply, sizeof(reply), "Level set to %f dBu\n", level);
 		break;
 	}
+	case AVERAGING:
+	{
+		float mode = 0.0;
+		bool parsed = ParseFloat(mode, connection->request.queryString);
+		if (!parsed || mode < 0.0 || mode > 3.0) {
+			httpWriteStream(connection, invalidParameterReply, sizeof(invalidParameterReply));
+			return NO_ERROR;
+		}
+
+		frontpanel.SetAveragingMode(static_cast<GeneratorParameters::AveragingMode>(int(mode)));
+		n = snprintf(reply, sizeof(reply), "Averaging mode set to %d\n", int(mode));
+		break;
+	}
+	case AVERAGES:
+	{
+		float averages = 0.0;
+		bool parsed = ParseFloat(averages, connection->request.queryString);
+		if (!parsed) {
+			httpWriteStream(connection, invalidParameterReply, sizeof(invalidParameterReply));
+			return NO_ERROR;
+		}
+		if (averages > 1000.0) averages = 1000.0;
+		else if (averages < 1.0) averages = 1.0;
+
+		frontpanel.SetAverages(int(averages));
+		n = snprintf(reply, sizeof(reply), "Averages set to %d\n", int(averages));
+		break;
+	}
+	case OVERLAP:
+	{
+		float overlap = 0.0;
+		bool parsed = ParseFloat(overlap, connection->request.queryString);
+		if (!parsed) {
+			httpWriteStream(connection, invalidParameterReply, sizeof(invalidParameterReply));
+			return NO_ERROR;
+		}
+		if (overlap > 0.9) overlap = 0.9;
+		else if (overlap < 0.0) overlap = 0.0;
+
+		frontpanel.SetOverlap(overlap);
+		n = snprintf(reply, sizeof(reply), "Overlap set to %f\n", overlap);
+		break;
+	}
+	case WINDOW:
+	{
+		float window = 0.0;
+		bool parsed = ParseFloat(window, connection->request.queryString);
+		if (!parsed || window < 0.0 || window > 4.0) {
+			httpWriteStream(connection, invalidParameterReply, sizeof(invalidParameterReply));
+			return NO_ERROR;
+		}
+
+		frontpanel.SetWindow(static_cast<GeneratorParameters::WindowFunction>(int(window)));
+		n = snprintf(reply, sizeof(reply), "Window set to %d\n", int(window));
+		break;
+	}
+	case ZOOM:
+	{
+		float zoom = 0.0;
+		bool parsed = ParseFloat(zoom, connection->request.queryString);
+		if (!parsed || zoom < 0.0 || zoom > 1.0) {
+			httpWriteStream(connection, invalidParameterReply, sizeof(invalidParameterReply));
+			return NO_ERROR;
+		}
+
+		frontpanel.SetZoom(zoom >= 0.5);
+		n = snprintf(reply, sizeof(reply), "Zoom set to %d\n", zoom >= 0.5 ? 1 : 0);
+		break;
+	}
+	case SAMPLERATE:
+	{
+		float samplerate = 0.0;
+		bool parsed = ParseFloat(samplerate, connection->request.queryString);
+		if (!parsed || (samplerate != 48000.0 && samplerate != 96000.0 && samplerate != 192000.0)) {
+			httpWriteStream(connection, invalidParameterReply, sizeof(invalidParameterReply));
+			return NO_ERROR;
+		}
+
+		frontpanel.SetSampleRate(int(samplerate));
+		n = snprintf(reply, sizeof(reply), "Sample rate set to %d\n", int(samplerate));
+		break;
+	}
+	case MODE:
+	{
+		float mode = 0.0;
+		bool parsed = ParseFloat(mode, connection->request.queryString);
+		if (!parsed || mode < 0.0 || mode > 3.0) {
+			httpWriteStream(connection, invalidParameterReply, sizeof(invalidParameterReply));
+			return NO_ERROR;
+		}
+
+		frontpanel.SetOperationMode(int(mode));
+		n = snprintf(reply, sizeof(reply), "Operation mode set to %d\n", int(mode));
+		break;
+	}
+	case COHERENT:
+	{
+		float coherent = 0.0;
+		bool parsed = ParseFloat(coherent, connection->request.queryString);
+		if (!parsed || coherent < 0.0 || coherent > 1.0) {
+			httpWriteStream(connection, invalidParameterReply, sizeof(invalidParameterReply));
+			return NO_ERROR;
+		}
+
+		frontpanel.SetCoherent(coherent >= 0.5);
+		n = snprintf(reply, sizeof(reply), "Coherent set to %d\n", coherent >= 0.5 ? 1 : 0);
+		break;
+	}
+	case RBW:
+	{
+		float rbw = 0.0;
+		bool parsed = ParseFloat(rbw, connection->request.queryString);
+		if (!parsed) {
+			httpWriteStream(connection, invalidParameterReply, sizeof(invalidParameterReply));
+			return NO_ERROR;
+		}
+		if (rbw > 1000.0) rbw = 1000.0;
+		else if (rbw < 0.0) rbw = 0.0;
+
+		frontpanel.SetRbw(rbw);
+		n = snprintf(reply, sizeof(reply), "Resolution bandwidth set to %f Hz\n", rbw);
+		break;
+	}
+	case NOISEFLOOR:
+	{
+		float noisefloor = 0.0;
+		bool parsed = ParseFloat(noisefloor, connection->request.queryString);
+		if (!parsed) {
+			httpWriteStream(connection, invalidParameterReply, sizeof(invalidParameterReply));
+			return NO_ERROR;
+		}
+		if (noisefloor > 0.0) noisefloor = 0.0;
+		else if (noisefloor < -200.0) noisefloor = -200.0;
+
+		frontpanel.SetNoiseFloor(noisefloor);
+		n = snprintf(reply, sizeof(reply), "Noise floor set to %f dBu\n", noisefloor);
+		break;
+	}
+	case MAXFFTSIZE:
+	{
+		float maxfftsize = 0.0;
+		bool parsed = ParseFloat(maxfftsize, connection->request.queryString);
+		if (!parsed) {
+			httpWriteStream(connection, invalidParameterReply, sizeof(invalidParameterReply));
+			return NO_ERROR;
+		}
+		if (maxfftsize > 65536.0) maxfftsize = 65536.0;
+		else if (maxfftsize < 1024.0) maxfftsize = 1024.0;
+
+		frontpanel.SetMaxFftSize(int(maxfftsize));
+		n = snprintf(reply, sizeof(reply), "Maximum FFT size set to %d\n", int(maxfftsize));
+		break;
+	}
+	case PROGRESSIVE:
+	{
+		float progressive = 0.0;
+		bool parsed = ParseFloat(progressive, connection->request.queryString);
+		if (!parsed || progressive < 0.0 || progressive > 1.0) {
+			httpWriteStream(connection, invalidParameterReply, sizeof(invalidParameterReply));
+			return NO_ERROR;
+		}
+
+		frontpanel.SetProgressive(progressive >= 0.5);
+		n = snprintf(reply, sizeof(reply), "Progressive set to %d\n", progressive >= 0.5 ? 1 : 0);
+		break;
+	}
+	case FOURSTEP:
+	{
+		float fourstep = 0.0;
+		bool parsed = ParseFloat(fourstep, connection->request.queryString);
+		if (!parsed || fourstep < 0.0 || fourstep > 1.0) {
+			httpWriteStream(connection, invalidParameterReply, sizeof(invalidParameterReply));
+			return NO_ERROR;
+		}
+
+		frontpanel.SetFourStep(fourstep >= 0.5);
+		n = snprintf(reply, sizeof(reply), "Four-step FFT set to %d\n", fourstep >= 0.5 ? 1 : 0);
+		break;
+	}
 	default:
 		// Shouldn't reach here, handled in Header()
 		return ERROR_NOT_FOUND;
@@ -0,0 +1,29 @@
+#include "../CgiCallback.h"
+
+#include "LoadCgiHandler.h"
+#include "sharedtypes.h"
+
+LoadCgiHandler::LoadCgiHandler()
+{
+}
+
+LoadCgiHandler::~LoadCgiHandler()
+{
+}
+
+error_t LoadCgiHandler::Header(HttpConnection *connection, HttpResponse *response)
+{
+	static const char mimeType[] = "application/octet-stream";
+	response->contentType = mimeType;
+
+	return NO_ERROR;
+}
+
+// Raw AudioLoad record of the last second of audio interrupts
+error_t LoadCgiHandler::Request(HttpConnection *connection)
+{
+	AudioLoad load;
+	audioLoad.Load(load);
+
+	return httpWriteStream(connection, &load, sizeof(load));
+}
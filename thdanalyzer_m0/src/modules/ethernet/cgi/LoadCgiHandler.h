@@ -0,0 +1,16 @@
+#ifndef LOADCGIHANDLER_H_
+#define LOADCGIHANDLER_H_
+
+#include "../CgiCallback.h"
+
+class LoadCgiHandler : public ICgiCallbackHandler
+{
+public:
+	LoadCgiHandler();
+	virtual ~LoadCgiHandler();
+
+	virtual error_t Header(HttpConnection *connection, HttpResponse *response);
+	virtual error_t Request(HttpConnection *connection);
+};
+
+#endif
@@ -2,6 +2,7 @@
 
 #include "MemoryDumpCgiHandler.h"
 #include "sharedtypes.h"
+#include "RingBuffer.h"
 
 MemoryDumpCgiHandler::MemoryDumpCgiHandler()
 {
@@ -21,33 +22,19 @@ error_t MemoryDumpCgiHandler::Header(HttpConnection *connection, HttpResponse *r
 
 error_t MemoryDumpCgiHandler::Request(HttpConnection *connection)
 {
-	const int32_t* startPtr = *oldestPtr;
-	const int32_t bufferend = 14*1048576;
-	int32_t startpos = (int32_t)startPtr & 0xFFFFFF;
-	int32_t endpos = startpos + 8*1048576;
-
-	int firstpartlen = 0;
-	int secondpartlen = 0;
-	if (endpos > bufferend) {
-		secondpartlen = endpos - bufferend;
-		firstpartlen = bufferend - startpos;
-	}
-	else {
-		firstpartlen = endpos - startpos;
-		secondpartlen = 0;
-	}
-
-	int secondstart = 0x28000000;
-	//httpWriteStream(connection, &firstpartlen, 4);
-	//httpWriteStream(connection, &startPtr, 4);
-	//httpWriteStream(connection, &secondpartlen, 4);
-	//httpWriteStream(connection, &secondstart, 4);
-
-	if (firstpartlen > 0) {
-		httpWriteStream(connection, (void*)startPtr, firstpartlen);
-	}
-	if (secondpartlen > 0) {
-		httpWriteStream(connection, (void*)0x28000000, secondpartlen);
+	dsp::RingReader<int32_t, INPUTRINGLEN> reader((const int32_t*)INPUTRINGADDRESS, *inputIndex, INPUTRINGGUARD);
+	dsp::RingExtent extent = reader.extent();
+
+	// up to 8 MB from the oldest sample on
+	uint64_t held = extent.end - extent.start;
+	int count = held < (8*1048576) / 4 ? int(held) : (8*1048576) / 4;
+	dsp::RingSpans<const int32_t> spans = reader.spans(extent.start, count);
+
+	for (int s = 0; s < 2; s++) {
+		// stop once the writer has caught up with the oldest sample sent
+		if (spans.len[s] > 0 && reader.valid(extent.start)) {
+			httpWriteStream(connection, (void*)spans.ptr[s], spans.len[s] * sizeof(int32_t));
+		}
 	}
 
 	return NO_ERROR;
@@ -0,0 +1,35 @@
+#include "../CgiCallback.h"
+
+#include "ResponseCgiHandler.h"
+#include "sharedtypes.h"
+#include "../../analyzercontrol.h"
+
+ResponseCgiHandler::ResponseCgiHandler()
+{
+}
+
+ResponseCgiHandler::~ResponseCgiHandler()
+{
+}
+
+error_t ResponseCgiHandler::Header(HttpConnection *connection, HttpResponse *response)
+{
+	static const char mimeType[] = "application/octet-stream";
+	response->contentType = mimeType;
+
+	return NO_ERROR;
+}
+
+// Raw ResponseResult record of the next measurement, without FlagValid
+// unless the analyzer is in frequency response mode
+error_t ResponseCgiHandler::Request(HttpConnection *connection)
+{
+	ResponseResult result;
+
+	analyzercontrol.AnalysisStart();
+	analyzercontrol.AnalysisRead();
+	responseResult.Load(result);
+	analyzercontrol.AnalysisFinish();
+
+	return httpWriteStream(connection, &result, sizeof(result));
+}
@@ -0,0 +1,16 @@
+#ifndef RESPONSECGIHANDLER_H_
+#define RESPONSECGIHANDLER_H_
+
+#include "../CgiCallback.h"
+
+class ResponseCgiHandler : public ICgiCallbackHandler
+{
+public:
+	ResponseCgiHandler();
+	virtual ~ResponseCgiHandler();
+
+	virtual error_t Header(HttpConnection *connection, HttpResponse *response);
+	virtual error_t Request(HttpConnection *connection);
+};
+
+#endif
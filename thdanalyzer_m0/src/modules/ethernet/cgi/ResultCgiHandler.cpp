@@ -0,0 +1,34 @@
+#include "../CgiCallback.h"
+
+#include "ResultCgiHandler.h"
+#include "sharedtypes.h"
+#include "../../analyzercontrol.h"
+
+ResultCgiHandler::ResultCgiHandler()
+{
+}
+
+ResultCgiHandler::~ResultCgiHandler()
+{
+}
+
+error_t ResultCgiHandler::Header(HttpConnection *connection, HttpResponse *response)
+{
+	static const char mimeType[] = "application/octet-stream";
+	response->contentType = mimeType;
+
+	return NO_ERROR;
+}
+
+// Raw AnalysisResult record of the next measurement
+error_t ResultCgiHandler::Request(HttpConnection *connection)
+{
+	AnalysisResult result;
+
+	analyzercontrol.AnalysisStart();
+	analyzercontrol.AnalysisRead();
+	analysisResult.Load(result);
+	analyzercontrol.AnalysisFinish();
+
+	return httpWriteStream(connection, &result, sizeof(result));
+}
@@ -0,0 +1,16 @@
+#ifndef RESULTCGIHANDLER_H_
+#define RESULTCGIHANDLER_H_
+
+#include "../CgiCallback.h"
+
+class ResultCgiHandler : public ICgiCallbackHandler
+{
+public:
+	ResultCgiHandler();
+	virtual ~ResultCgiHandler();
+
+	virtual error_t Header(HttpConnection *connection, HttpResponse *response);
+	virtual error_t Request(HttpConnection *connection);
+};
+
+#endif
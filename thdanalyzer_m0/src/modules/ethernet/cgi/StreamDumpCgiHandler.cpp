@@ -2,6 +2,7 @@
 
 #include "StreamDumpCgiHandler.h"
 #include "sharedtypes.h"
+#include "RingBuffer.h"
 
 StreamDumpCgiHandler::StreamDumpCgiHandler()
 {
@@ -21,41 +22,36 @@ error_t StreamDumpCgiHandler::Header(HttpConnection *connection, HttpResponse *r
 
 error_t StreamDumpCgiHandler::Request(HttpConnection *connection)
 {
-	const int32_t* startptr = *latestPtr;
-	int32_t startpos = (int32_t)startptr & 0xFFFFFF;
-	const int32_t bufferend = 0xE00000;
-	const int32_t* bufferptr = (int32_t*)0x28000000;
-
-	static const volatile int32_t* greatestptr = 0;
+	dsp::RingReader<int32_t, INPUTRINGLEN> reader((const int32_t*)INPUTRINGADDRESS, *inputIndex, INPUTRINGGUARD);
+	uint64_t position = reader.extent().end;
 
 	error_t error;
 	do {
 		// wait for more data
-		const int32_t* curptr = *latestPtr;
-		while (curptr == startptr) {
-			curptr = *latestPtr;
+		dsp::RingExtent extent = reader.extent();
+		while (extent.end == position) {
+			extent = reader.extent();
 		}
 
-		if (curptr > greatestptr) greatestptr = curptr;
-
-		int32_t curpos = (int32_t)curptr & 0xFFFFFF;
-		if (curpos >= bufferend) {
-			curpos -= bufferend;
+		// the client fell a whole ring behind
+		if (!reader.valid(position)) {
+			break;
 		}
 
-		if (curpos < startpos) {
-			if (startpos != bufferend) {
-				error = httpWriteStream(connection, startptr, bufferend - startpos);
-			}
-			if (curpos != 0) {
-				error = httpWriteStream(connection, bufferptr, curpos);
+		dsp::RingSpans<const int32_t> spans = reader.spans(position, int(extent.end - position));
+		error = NO_ERROR;
+		for (int s = 0; s < 2 && error == NO_ERROR; s++) {
+			if (spans.len[s] > 0) {
+				error = httpWriteStream(connection, spans.ptr[s], spans.len[s] * sizeof(int32_t));
 			}
 		}
-		else {
-			error = httpWriteStream(connection, startptr, curpos - startpos);
+
+		// samples overwritten while they were sent
+		if (!reader.valid(position)) {
+			break;
 		}
-		startptr = curptr;
-		startpos = curpos;
+
+		position = extent.end;
 
 	} while(error == NO_ERROR);
 
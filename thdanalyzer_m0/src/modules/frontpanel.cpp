@@ -292,6 +292,11 @@ void FrontPanel::Update()
 		Configure();
 	}
 
+	GeneratorAck ack;
+	if (analyzercontrol.ConfigurationAck(ack)) {
+		_state->SetGeneratorFrequency(ack._frequency);
+	}
+
 	if (_state->NeedRefresh()) {
 		RefreshLeds();
 		lcdview.Refresh();
@@ -310,6 +315,71 @@ void FrontPanel::SetLevel(float level)
 	_state->SetLevel(level);
 }
 
+void FrontPanel::SetAveragingMode(GeneratorParameters::AveragingMode mode)
+{
+	_state->SetAveragingMode(mode);
+}
+
+void FrontPanel::SetAverages(int averages)
+{
+	_state->SetAverages(averages);
+}
+
+void FrontPanel::SetOverlap(float overlap)
+{
+	_state->SetOverlap(overlap);
+}
+
+void FrontPanel::SetWindow(GeneratorParameters::WindowFunction window)
+{
+	_state->SetWindow(window);
+}
+
+void FrontPanel::SetZoom(bool zoom)
+{
+	_state->SetZoom(zoom);
+}
+
+void FrontPanel::SetSampleRate(int samplerate)
+{
+	_state->SetSampleRate(samplerate);
+}
+
+void FrontPanel::SetCoherent(bool coherent)
+{
+	_state->SetCoherent(coherent);
+}
+
+void FrontPanel::SetRbw(float rbw)
+{
+	_state->SetRbw(rbw);
+}
+
+void FrontPanel::SetNoiseFloor(float noisefloor)
+{
+	_state->SetNoiseFloor(noisefloor);
+}
+
+void FrontPanel::SetMaxFftSize(int maxfftsize)
+{
+	_state->SetMaxFftSize(maxfftsize);
+}
+
+void FrontPanel::SetProgressive(bool progressive)
+{
+	_state->SetProgressive(progressive);
+}
+
+void FrontPanel::SetFourStep(bool fourstep)
+{
+	_state->SetFourStep(fourstep);
+}
+
+void FrontPanel::SetOperationMode(int mode)
+{
+	_state->SetOperationMode(static_cast<enum FrontPanelState::OperationMode>(mode));
+}
+
 void FrontPanel::Auto()
 {
 
@@ -424,6 +494,7 @@ void FrontPanel::MoveGain(int32_t delta)
 	switch (_state->OperationMode()) {
 	case FrontPanelState::OperationModeTHD:
 	case FrontPanelState::OperationModeFrequencyAnalysis:
+	case FrontPanelState::OperationModeFrequencyResponse:
 		{
 			float level = _state->Level();
 			if (level <= -100.0) {
@@ -457,6 +528,7 @@ void FrontPanel::MoveFrequency(int32_t delta)
 	switch (_state->OperationMode()) {
 	case FrontPanelState::OperationModeTHD:
 	case FrontPanelState::OperationModeFrequencyAnalysis:
+	case FrontPanelState::OperationModeFrequencyResponse:
 		{
 			float frequency = _state->Frequency();
 			if (frequency < 100.0) {
@@ -544,5 +616,17 @@ void FrontPanel::Configure()
 	currentparams._cv0 = _state->Enable() ? _state->Cv0() : 0.0;
 	currentparams._cv1 = _state->Enable() ? _state->Cv1() : 0.0;
 	currentparams._analysismode = static_cast<GeneratorParameters::OperationMode>(_state->OperationMode());
+	currentparams._averagingmode = _state->AveragingMode();
+	currentparams._averages = _state->Averages();
+	currentparams._overlap = _state->Overlap();
+	currentparams._window = _state->Window();
+	currentparams._zoom = _state->Zoom();
+	currentparams._samplerate = _state->SampleRate();
+	currentparams._coherent = _state->Coherent();
+	currentparams._rbw = _state->Rbw();
+	currentparams._noisefloor = _state->NoiseFloor();
+	currentparams._maxfftsize = _state->MaxFftSize();
+	currentparams._progressive = _state->Progressive();
+	currentparams._fourstep = _state->FourStep();
 	analyzercontrol.SetConfiguration(currentparams);
 }
@@ -2,6 +2,7 @@
 #define FRONTPANEL_H_
 
 #include "frontpanelcontrols.h"
+#include "sharedtypes.h"
 
 class FrontPanelState;
 
@@ -17,6 +18,19 @@ public:
 
 	void SetFrequency(float frequency);
 	void SetLevel(float level);
+	void SetAveragingMode(GeneratorParameters::AveragingMode mode);
+	void SetAverages(int averages);
+	void SetOverlap(float overlap);
+	void SetWindow(GeneratorParameters::WindowFunction window);
+	void SetZoom(bool zoom);
+	void SetSampleRate(int samplerate);
+	void SetOperationMode(int mode);
+	void SetCoherent(bool coherent);
+	void SetRbw(float rbw);
+	void SetNoiseFloor(float noisefloor);
+	void SetMaxFftSize(int maxfftsize);
+	void SetProgressive(bool progressive);
+	void SetFourStep(bool fourstep);
 
 private:
 	void Auto();
@@ -17,7 +17,8 @@ public:
 	enum OperationMode {
 		OperationModeTHD = 0,
 		OperationModeFrequencyAnalysis = 1,
-		OperationModeDCVoltageControl = 2
+		OperationModeDCVoltageControl = 2,
+		OperationModeFrequencyResponse = 3
 	};
 
 	FrontPanelState()
@@ -31,6 +32,7 @@ public:
 		_balancedio = true;
 
 		_frequency = 1000;
+		_generatorfrequency = 1000;
 		_level = 4;
 		_reflevelmode = RefLevel4dBu;
 
@@ -43,6 +45,19 @@ public:
 
 		_cv0 = 0.0;
 		_cv1 = 0.0;
+
+		_averagingmode = GeneratorParameters::AveragingModeNone;
+		_averages = 1;
+		_overlap = 0.5;
+		_window = GeneratorParameters::WindowFunctionFlatTop;
+		_zoom = false;
+		_samplerate = 48000;
+		_coherent = false;
+		_rbw = 0;
+		_noisefloor = -130.0;
+		_maxfftsize = 65536;
+		_progressive = false;
+		_fourstep = true;
 	}
 
 	void SetOperationMode(OperationMode mode)
@@ -80,6 +95,10 @@ public:
 	void SetLevel(float level) { _level = ValidateLevel(level); Configure(); Refresh(); }
 	float Level() const { return _level; }
 
+	// frequency the generator runs at, moved onto an FFT bin in coherent mode
+	void SetGeneratorFrequency(float frequency) { _generatorfrequency = frequency; Refresh(); }
+	float GeneratorFrequency() const { return _generatorfrequency; }
+
 	void SetDistortionFrequency(float frequency) { _distortionfrequency = frequency; Refresh(); }
 	float DistortionFrequency() const { return _distortionfrequency; }
 
@@ -154,6 +173,42 @@ public:
 		SetLevel(level - RelativeLevelGain());
 	}
 
+	void SetAveragingMode(GeneratorParameters::AveragingMode mode) { _averagingmode = mode; Configure(); }
+	GeneratorParameters::AveragingMode AveragingMode() const { return _averagingmode; }
+
+	void SetAverages(int averages) { _averages = averages; Configure(); }
+	int Averages() const { return _averages; }
+
+	void SetOverlap(float overlap) { _overlap = overlap; Configure(); }
+	float Overlap() const { return _overlap; }
+
+	void SetWindow(GeneratorParameters::WindowFunction window) { _window = window; Configure(); }
+	GeneratorParameters::WindowFunction Window() const { return _window; }
+
+	void SetZoom(bool zoom) { _zoom = zoom; Configure(); }
+	bool Zoom() const { return _zoom; }
+
+	void SetSampleRate(int samplerate) { _samplerate = samplerate; Configure(); }
+	int SampleRate() const { return _samplerate; }
+
+	void SetCoherent(bool coherent) { _coherent = coherent; Configure(); }
+	bool Coherent() const { return _coherent; }
+
+	void SetRbw(float rbw) { _rbw = rbw; Configure(); }
+	float Rbw() const { return _rbw; }
+
+	void SetNoiseFloor(float noisefloor) { _noisefloor = noisefloor; Configure(); }
+	float NoiseFloor() const { return _noisefloor; }
+
+	void SetMaxFftSize(int maxfftsize) { _maxfftsize = maxfftsize; Configure(); }
+	int MaxFftSize() const { return _maxfftsize; }
+
+	void SetProgressive(bool progressive) { _progressive = progressive; Configure(); }
+	bool Progressive() const { return _progressive; }
+
+	void SetFourStep(bool fourstep) { _fourstep = fourstep; Configure(); }
+	bool FourStep() const { return _fourstep; }
+
 	bool NeedConfigure() { bool need = _needconfigure; _needconfigure = false; return need; }
 	bool NeedRefresh() { bool need = _needrefresh; _needrefresh = false; return need; }
 
@@ -171,6 +226,7 @@ private:
 	bool _needrefresh;
 
 	float _frequency;
+	float _generatorfrequency;
 	float _level;
 
 	float _distortionfrequency;
@@ -179,6 +235,19 @@ private:
 	float _cv0;
 	float _cv1;
 
+	GeneratorParameters::AveragingMode _averagingmode;
+	int _averages;
+	float _overlap;
+	GeneratorParameters::WindowFunction _window;
+	bool _zoom;
+	int _samplerate;
+	bool _coherent;
+	float _rbw;
+	float _noisefloor;
+	int _maxfftsize;
+	bool _progressive;
+	bool _fourstep;
+
 	enum OperationMode _operationmode;
 	bool _enable;
 	bool _balancedio;
@@ -37,7 +37,7 @@ void FillSpaces(char* buffer, int size)
 void LcdView::RenderLevelFrequency()
 {
 	char text[17];
-	AnalyzerFormat::Format(_state->Frequency(), _state->Level(), text, _state->GeneratorFrequencyDisplayMode(), _state->GeneratorLevelDisplayMode(), _state);
+	AnalyzerFormat::Format(_state->GeneratorFrequency(), _state->Level(), text, _state->GeneratorFrequencyDisplayMode(), _state->GeneratorLevelDisplayMode(), _state);
 	lcd.Locate(0, 0);
 	lcd.Print(text);
 
@@ -84,6 +84,7 @@ void LcdView::Refresh()
 	{
 	case FrontPanelState::OperationModeTHD:
 	case FrontPanelState::OperationModeFrequencyAnalysis:
+	case FrontPanelState::OperationModeFrequencyResponse:
 		RenderLevelFrequency();
 		break;
 	case FrontPanelState::OperationModeDCVoltageControl:
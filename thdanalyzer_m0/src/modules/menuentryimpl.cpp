@@ -99,6 +99,9 @@ void OperationModeMenuEntry::Render(FrontPanelState* state, LcdBuffer& buffer) c
 	case FrontPanelState::OperationModeDCVoltageControl:
 		strncpy(buffer.row2, "DC Voltage", buffer.Width());
 		break;
+	case FrontPanelState::OperationModeFrequencyResponse:
+		strncpy(buffer.row2, "Freq.Response", buffer.Width());
+		break;
 	}
 }
 
@@ -107,7 +110,8 @@ void OperationModeMenuEntry::ChangeValue(FrontPanelState* state, int delta) cons
 	const static enum FrontPanelState::OperationMode presets[] = {
 			FrontPanelState::OperationModeTHD,
 			FrontPanelState::OperationModeFrequencyAnalysis,
-			FrontPanelState::OperationModeDCVoltageControl
+			FrontPanelState::OperationModeDCVoltageControl,
+			FrontPanelState::OperationModeFrequencyResponse
 	};
 
 	state->SetOperationMode(enumselect(presets, state->OperationMode(), delta));
@@ -1,8 +1,17 @@
 #ifndef SHAREDTYPES_H_
 #define SHAREDTYPES_H_
 
+#include <stdint.h>
+
+// mailboxes and slots, up to the end of the 16 kB ETB SRAM at 0x2000C000
 #define COMMON_SHMEM_ADDRESS (0x2000C010)
-//#define COMMON_SHMEM_SIZE (256)
+#define COMMON_SHMEM_SIZE (0x4000 - 0x10)
+
+// input ring in SDRAM, written by the M4 and published through inputIndex
+#define INPUTRINGADDRESS (0x28000000)
+#define INPUTRINGLEN ((13*1048576)/4)
+// samples the writer stores past the published end, one audio block
+#define INPUTRINGGUARD (64)
 
 struct GeneratorParameters
 {
@@ -14,7 +23,9 @@ struct GeneratorParameters
 	{
 		OperationModeTHD = 0,
 		OperationModeFrequencyAnalysis = 1,
-		OperationModeDCVoltageControl = 2
+		OperationModeDCVoltageControl = 2,
+		// multitone stimulus, response from one capture
+		OperationModeFrequencyResponse = 3
 	};
 
 	OperationMode _analysismode;
@@ -22,6 +33,54 @@ struct GeneratorParameters
 	float _cv0;
 	float _cv1;
 
+	enum AveragingMode
+	{
+		AveragingModeNone = 0,
+		AveragingModeLinear = 1,
+		AveragingModeExponential = 2,
+		AveragingModePeakHold = 3
+	};
+
+	AveragingMode _averagingmode;
+	// number of frames, or time constant in frames for exponential averaging
+	int _averages;
+	// fraction of frame length shared by successive frames, 0..0.9
+	float _overlap;
+
+	// same order as WindowKind in lib/window.h
+	enum WindowFunction
+	{
+		WindowFunctionFlatTop = 0,
+		WindowFunctionHann = 1,
+		WindowFunctionBlackmanHarris4 = 2,
+		WindowFunctionBlackmanHarris7 = 3,
+		WindowFunctionRectangular = 4
+	};
+
+	WindowFunction _window;
+
+	// zoom analysis for low fundamentals, THD mode without averaging
+	bool _zoom;
+
+	// 48000, 96000 or 192000
+	int _samplerate;
+
+	// generator moved onto an FFT bin, analysis without a window
+	bool _coherent;
+
+	// FFT size policy: the smallest transform with a resolution bandwidth
+	// of at most _rbw Hz (0 for any) and a noise floor per bin of at most
+	// _noisefloor dBu, but no more than _maxfftsize points
+	float _rbw;
+	float _noisefloor;
+	int _maxfftsize;
+
+	// publish results from smaller transforms while input accumulates
+	bool _progressive;
+
+	// large transforms in tiles through local SRAM, else in place in SDRAM
+	bool _fourstep;
+
 	GeneratorParameters() {}
 
 	GeneratorParameters(float frequency, float level, bool balancedio, OperationMode analysismode, float cv0, float cv1)
@@ -30,11 +89,31 @@ struct GeneratorParameters
 	  _balancedio(balancedio),
 	  _analysismode(analysismode),
 	  _cv0(cv0),
-	  _cv1(cv1)
+	  _cv1(cv1),
+	  _averagingmode(AveragingModeNone),
+	  _averages(1),
+	  _overlap(0.5),
+	  _window(WindowFunctionFlatTop),
+	  _zoom(false),
+	  _samplerate(48000),
+	  _coherent(false),
+	  _rbw(0),
+	  _noisefloor(-130.0),
+	  _maxfftsize(65536),
+	  _progressive(false),
+	  _fourstep(true)
 	{
 	}
 };
 
+// Reply to a command with the generator frequency actually used
+struct GeneratorAck
+{
+	float _frequency;
+	// FFT size the frequency is coherent with, 0 if not coherent
+	int _fftsize;
+};
+
 struct AnalysisCommand
 {
 	enum CommandType {
@@ -45,8 +124,82 @@ struct AnalysisCommand
 	CommandType commandType;
 };
 
+// Highest harmonic reported is ANALYSISMAXHARMONICS + 1
+#define ANALYSISMAXHARMONICS 16
+
+// Measurement summary written by the analyzer with each result.
+// Levels are in dB relative to 0 dBu, ratios in dB relative to the fundamental.
+struct AnalysisResult
+{
+	enum Flags
+	{
+		FlagValid = 1,
+		// THD+N, noise and SINAD were measured from a full spectrum
+		FlagNoise = 2,
+		// from the full size transform, later results will not refine it
+		FlagFinal = 4
+	};
+
+	uint32_t _flags;
+	int _fftsize;
+	// size the progressive results are working up to
+	int _targetfftsize;
+	// resolution bandwidth in Hz
+	float _rbw;
+
+	float _fundamentalfrequency;
+	float _fundamentallevel;
+
+	// harmonic H(i+2) at index i
+	int _numharmonics;
+	float _harmoniclevel[ANALYSISMAXHARMONICS];
+	int _harmonicbin[ANALYSISMAXHARMONICS];
+
+	float _thd;
+	float _thdn;
+	// integrated noise without the fundamental and harmonics
+	float _noiselevel;
+	float _sinad;
+};
+
+// Audio interrupt load, reported by the M4 about once a second
+struct AudioLoad
+{
+	int _samplerate;
+	// core cycles per frame at the sample rate
+	int _budget;
+	// block processing cycles per frame, mean and worst block
+	int _cycles;
+	int _maxcycles;
+	// fraction of the budget left in the worst block
+	float _headroom;
+};
+
+// Most tones in a frequency response
+#define RESPONSEMAXTONES 32
+
+// Frequency response from one multitone capture, one entry per tone.
+// Gain is in dB relative to the generated tone, phase in degrees relative
+// to it and includes the group delay of the converters.
+struct ResponseResult
+{
+	enum Flags
+	{
+		FlagValid = 1
+	};
+
+	uint32_t _flags;
+	int _fftsize;
+
+	int _numtones;
+	float _frequency[RESPONSEMAXTONES];
+	float _gain[RESPONSEMAXTONES];
+	float _phase[RESPONSEMAXTONES];
+};
+
 #include "IpcMailbox.h"
 #include "MemorySlot.h"
+#include "RingBuffer.h"
 
 namespace {
 	typedef IpcMailboxMemory<COMMON_SHMEM_ADDRESS> MailboxMemory;
@@ -54,7 +207,7 @@ namespace {
 	typedef IpcMailbox<GeneratorParameters, MailboxMemory> CommandMailbox;
 	CommandMailbox commandMailbox;
 
-	typedef IpcMailbox<bool, CommandMailbox> AckMailbox;
+	typedef IpcMailbox<GeneratorAck, CommandMailbox> AckMailbox;
 	AckMailbox ackMailbox;
 
 	typedef IpcMailbox<AnalysisCommand, AckMailbox> AnalysisCommandMailbox;
@@ -63,17 +216,29 @@ namespace {
 	typedef IpcMailbox<bool, AnalysisCommandMailbox> AnalysisAckMailbox;
 	AnalysisAckMailbox analysisAckMailbox;
 
-	typedef MemorySlot<const int32_t*, AnalysisAckMailbox> OldestPtr;
-	OldestPtr oldestPtr;
-
-	typedef MemorySlot<const int32_t*, OldestPtr> LatestPtr;
-	LatestPtr latestPtr;
+	typedef MemorySlot<dsp::RingIndex, AnalysisAckMailbox> InputIndex;
+	InputIndex inputIndex;
 
-	typedef MemorySlot<float, LatestPtr> DistortionLevel;
+	typedef MemorySlot<float, InputIndex> DistortionLevel;
 	DistortionLevel distortionLevel;
 
 	typedef MemorySlot<float, DistortionLevel> DistortionFrequency;
 	DistortionFrequency distortionFrequency;
+
+	typedef MemorySlot<AnalysisResult, DistortionFrequency> AnalysisResultSlot;
+	AnalysisResultSlot analysisResult;
+
+	typedef MemorySlot<AudioLoad, AnalysisResultSlot> AudioLoadSlot;
+	AudioLoadSlot audioLoad;
+
+	typedef MemorySlot<ResponseResult, AudioLoadSlot> ResponseResultSlot;
+	ResponseResultSlot responseResult;
+}
+
+// Whether the chain above ends inside the shared region, checked at start
+inline bool SharedMemoryFits()
+{
+	return ResponseResultSlot::EndPtr() <= COMMON_SHMEM_ADDRESS + COMMON_SHMEM_SIZE;
 }
 
 #endif /* SHAREDTYPES_H_ */
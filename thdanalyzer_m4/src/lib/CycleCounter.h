@@ -0,0 +1,41 @@
+#ifndef CYCLECOUNTER_H_
+#define CYCLECOUNTER_H_
+
+#include "LPC43xx.h"
+
+// Core clock cycle counter using the DWT unit
+class CycleCounter
+{
+public:
+	static void Enable()
+	{
+		CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+		DWT->CYCCNT = 0;
+		DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+	}
+
+	static uint32_t Now()
+	{
+		return DWT->CYCCNT;
+	}
+
+	CycleCounter()
+	: _start(Now())
+	{
+	}
+
+	void Restart()
+	{
+		_start = Now();
+	}
+
+	uint32_t Elapsed() const
+	{
+		return Now() - _start;
+	}
+
+private:
+	uint32_t _start;
+};
+
+#endif /* CYCLECOUNTER_H_ */
@@ -15,94 +15,104 @@ public:
 	}
 };
 
-template <typename T, typename Memory>
+// Single producer, single consumer queue of up to slots messages in
+// memory shared by the cores. The writer owns the write count and the
+// reader the read count, a message is published by the count after it,
+// so neither side ever waits on the other.
+template <typename T, typename Memory, int slots = 4>
 class IpcMailbox
 {
 private:
-	enum MailboxStatus
+	static uint32_t RoundPtr(uint32_t ptr)
 	{
-		MailboxStatusFree,
-		MailboxStatusPending
-	};
+		return (ptr + 3) & ~3;
+	}
 
-	static uint32_t RoundPtr(uint32_t ptr)
+	static volatile uint32_t* WriteCount()
 	{
-		if (sizeof(T) < 4) {
-			return (ptr + 3) & ~3;
-		}
-		else {
-			return (ptr + sizeof(T)-1) & ~(sizeof(T)-1);
-		}
+		return reinterpret_cast<volatile uint32_t*> (RoundPtr(Memory::EndPtr()));
+	}
+
+	static volatile uint32_t* ReadCount()
+	{
+		return WriteCount() + 1;
+	}
+
+	static T* Slot(uint32_t count)
+	{
+		uint32_t first = RoundPtr(Memory::EndPtr()) + 2*sizeof(uint32_t);
+		return reinterpret_cast<T*> (first + (count % slots) * RoundPtr(sizeof(T)));
 	}
 
 public:
 	IpcMailbox()
 	{
-		volatile MailboxStatus* statusptr = reinterpret_cast<volatile MailboxStatus*> (RoundPtr(Memory::EndPtr()));
-
-		*statusptr = MailboxStatusFree;
+		*WriteCount() = 0;
+		*ReadCount() = 0;
 	}
 
 	static uint32_t EndPtr()
 	{
-		return RoundPtr(Memory::EndPtr() + sizeof(uint32_t)) + RoundPtr(sizeof(T));
+		return RoundPtr(Memory::EndPtr()) + 2*sizeof(uint32_t) + slots * RoundPtr(sizeof(T));
+	}
+
+	static int Slots()
+	{
+		return slots;
 	}
 
 	bool CanWrite() const
 	{
-		volatile MailboxStatus* const statusptr = reinterpret_cast<volatile MailboxStatus*> (RoundPtr(Memory::EndPtr()));
-		return *statusptr == MailboxStatusFree;
+		return *WriteCount() - *ReadCount() < uint32_t(slots);
 	}
 
-	void Write(const T& data)
+	// Queue a copy of data, false if the queue is full
+	bool Write(const T& data)
 	{
-		volatile MailboxStatus* const statusptr = reinterpret_cast<volatile MailboxStatus*> (RoundPtr(Memory::EndPtr()));
-		T* tptr = reinterpret_cast<T*> (RoundPtr(Memory::EndPtr() + sizeof(uint32_t)));
+		uint32_t written = *WriteCount();
+		if (written - *ReadCount() >= uint32_t(slots)) {
+			return false;
+		}
 
-		// block if mailbox is reserved
-		while (!CanWrite());
+		*Slot(written) = data;
 
-		// ok, now it's free
-		*tptr = data;
-		*statusptr = MailboxStatusPending;
+		// message before the count that publishes it
+		__DMB();
+		*WriteCount() = written + 1;
 
-		// memory barrier
+		// visible to the other core before any event raised after this
 		__DSB();
 
-		// trigger remote processor
-		//__SEV();
+		return true;
 	}
 
-	bool CanRead() const {
-		volatile MailboxStatus* const statusptr = reinterpret_cast<volatile MailboxStatus*> (RoundPtr(Memory::EndPtr()));
-		return *statusptr == MailboxStatusPending;
+	bool CanRead() const
+	{
+		return *ReadCount() != *WriteCount();
 	}
 
+	// Take the oldest message, false if there is none
 	bool Read(T& target)
 	{
-		volatile MailboxStatus* const statusptr = reinterpret_cast<volatile MailboxStatus*> (RoundPtr(Memory::EndPtr()));
-		if (!CanRead()) {
+		uint32_t read = *ReadCount();
+		if (read == *WriteCount()) {
 			return false;
 		}
 
-		T* tptr = reinterpret_cast<T*> (RoundPtr(Memory::EndPtr() + sizeof(uint32_t)));
-		target = *tptr;
+		__DMB();
+		target = *Slot(read);
 
-		*statusptr = MailboxStatusFree;
+		// copied before the slot is handed back
+		__DMB();
+		*ReadCount() = read + 1;
 
 		return true;
 	}
 
 	bool Read()
 	{
-		volatile MailboxStatus* statusptr = reinterpret_cast<volatile MailboxStatus*> (RoundPtr(Memory::EndPtr()));
-		if (!CanRead()) {
-			return false;
-		}
-
-		*statusptr = MailboxStatusFree;
-
-		return true;
+		T discard;
+		return Read(discard);
 	}
 };
 
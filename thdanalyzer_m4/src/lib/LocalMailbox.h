@@ -17,6 +17,11 @@ public:
 		_status = MailboxStatusFree;
 	}
 
+	bool CanWrite() const
+	{
+		return _status == MailboxStatusFree;
+	}
+
 	void Write(const T& data)
 	{
 		// block if mailbox is reserved
@@ -6,7 +6,8 @@ class MemorySlot
 {
 	static uint32_t RoundPtr(uint32_t ptr)
 	{
-		if (sizeof(T) < 4) {
+		if (sizeof(T) < 4 || (sizeof(T) & (sizeof(T)-1)) != 0) {
+			// small or record types are word aligned
 			return (ptr + 3) & ~3;
 		}
 		else {
@@ -14,15 +15,58 @@ class MemorySlot
 		}
 	}
 
+	// sequence count for whole record access, ahead of the value
+	static uint32_t SequencePtr()
+	{
+		return (Memory::EndPtr() + 3) & ~3;
+	}
+
+	static uint32_t ValuePtr()
+	{
+		return RoundPtr(SequencePtr() + sizeof(uint32_t));
+	}
+
 public:
 	static uint32_t EndPtr()
 	{
-		return RoundPtr(Memory::EndPtr()) + RoundPtr(sizeof(T));
+		return ValuePtr() + RoundPtr(sizeof(T));
 	}
 
 	volatile T& operator*()
 	{
-		return * reinterpret_cast<volatile T*> (Memory::EndPtr());
+		return * reinterpret_cast<volatile T*> (ValuePtr());
+	}
+
+	// Whole record access, for structs that can't be assigned through
+	// volatile. The count is odd while the one writer stores, readers on
+	// either core retry until they copied the record between two equal
+	// even counts.
+	void Store(const T& value)
+	{
+		volatile uint32_t* seqptr = reinterpret_cast<volatile uint32_t*> (SequencePtr());
+
+		// odd whatever the memory held at power up
+		uint32_t seq = *seqptr | 1;
+		*seqptr = seq;
+		__DMB();
+		*reinterpret_cast<T*> (ValuePtr()) = value;
+		__DMB();
+		*seqptr = seq + 1;
+	}
+
+	void Load(T& value)
+	{
+		const volatile uint32_t* seqptr = reinterpret_cast<const volatile uint32_t*> (SequencePtr());
+
+		for (;;) {
+			uint32_t seq = *seqptr;
+			__DMB();
+			value = *reinterpret_cast<const T*> (ValuePtr());
+			__DMB();
+			if (!(seq & 1) && seq == *seqptr) {
+				return;
+			}
+		}
 	}
 };
 
@@ -25,9 +25,208 @@
  */
 
 #pragma once
-
-namespace dsp
-{
+
+#include <stdint.h>
+#include "LPC43xx.h"
+
+namespace dsp
+{
+
+// A range of ring samples as at most two contiguous pieces, preceded by
+// zeros where the range reaches back past the oldest sample
+template<typename T> struct RingSpans {
+	int zeros;
+	T* ptr[2];
+	int len[2];
+
+	int length() const {
+		return zeros + len[0] + len[1];
+	}
+};
+
+// count samples from index start of a ring of len samples
+template<typename T> RingSpans<T> ringspans(T* buffer, int len, int start, int count) {
+	RingSpans<T> spans;
+	spans.zeros = 0;
+	spans.ptr[0] = &buffer[start];
+	spans.ptr[1] = buffer;
+
+	if (start + count > len) {
+		spans.len[0] = len - start;
+		spans.len[1] = count - spans.len[0];
+	} else {
+		spans.len[0] = count;
+		spans.len[1] = 0;
+	}
+
+	return spans;
+}
+
+// copy the range out, converting to U
+template<typename T, typename U> void spancopy(const RingSpans<T>& spans, U* out) {
+	for (int i = 0; i < spans.zeros; ++i)
+		*out++ = 0;
+
+	for (int s = 0; s < 2; ++s) {
+		T* p = spans.ptr[s];
+		for (int i = spans.len[s]; i > 0; --i)
+			*out++ = *p++;
+	}
+}
+
+// split interleaved pairs into out0 and out1, converting to U, and add
+// them up into sum0 and sum1. zeros must be even.
+template<typename T, typename U, typename S> void spandeinterleave(const RingSpans<T>& spans, U* out0, U* out1, S& sum0, S& sum1) {
+	for (int i = spans.zeros / 2; i > 0; --i) {
+		*out0++ = 0;
+		*out1++ = 0;
+	}
+
+	T* p = spans.ptr[0];
+	int n = spans.len[0];
+	for (; n >= 2; n -= 2) {
+		T a = p[0];
+		T b = p[1];
+		p += 2;
+		sum0 += a;
+		sum1 += b;
+		*out0++ = a;
+		*out1++ = b;
+	}
+
+	T* q = spans.ptr[1];
+	int m = spans.len[1];
+
+	// pair split by the wrap
+	if (n == 1 && m > 0) {
+		T a = *p;
+		T b = *q++;
+		m--;
+		sum0 += a;
+		sum1 += b;
+		*out0++ = a;
+		*out1++ = b;
+	}
+
+	for (; m >= 2; m -= 2) {
+		T a = q[0];
+		T b = q[1];
+		q += 2;
+		sum0 += a;
+		sum1 += b;
+		*out0++ = a;
+		*out1++ = b;
+	}
+}
+
+// Absolute positions count the samples ever written, the sample at
+// position p lives at index p % len
+struct RingExtent {
+	uint64_t start;
+	uint64_t end;
+};
+
+// Extent of a ring published by its single writer to readers on the
+// other core or in the code it interrupts. seq is odd while the writer
+// is updating, a reader retries until it sees the same even seq on
+// both sides of its loads.
+class RingIndex {
+public:
+	void reset() volatile {
+		_seq = 0;
+		_startlo = _starthi = 0;
+		_endlo = _endhi = 0;
+	}
+
+	// samples up to extent.end must be stored before this
+	void publish(const RingExtent& extent) volatile {
+		uint32_t seq = _seq;
+		__DMB();
+		_seq = seq + 1;
+		__DMB();
+		_startlo = uint32_t(extent.start);
+		_starthi = uint32_t(extent.start >> 32);
+		_endlo = uint32_t(extent.end);
+		_endhi = uint32_t(extent.end >> 32);
+		__DMB();
+		_seq = seq + 2;
+	}
+
+	RingExtent load() const volatile {
+		RingExtent extent;
+		for (;;) {
+			uint32_t seq = _seq;
+			__DMB();
+			extent.start = (uint64_t(_starthi) << 32) | _startlo;
+			extent.end = (uint64_t(_endhi) << 32) | _endlo;
+			__DMB();
+			if (!(seq & 1) && seq == _seq)
+				return extent;
+		}
+	}
+
+private:
+	uint32_t _seq;
+	uint32_t _startlo, _starthi;
+	uint32_t _endlo, _endhi;
+};
+
+// Read side of a ring of LEN samples published through a RingIndex.
+// The writer may store up to guard samples past the published end
+// before it publishes again, overwriting the oldest ones, so data read
+// from a position is only good if valid() still holds afterwards.
+template<typename T, int LEN> class RingReader {
+public:
+	typedef RingSpans<const T> Spans;
+
+	RingReader(const T* buffer, const volatile RingIndex& index, int guard = 0)
+	  : _buffer(buffer), _index(index), _guard(guard)
+	{
+	}
+
+	RingExtent extent() const {
+		return _index.load();
+	}
+
+	bool valid(uint64_t position) const {
+		RingExtent e = extent();
+		return position + LEN >= e.end + _guard;
+	}
+
+	// count samples from position on
+	Spans spans(uint64_t position, int count) const {
+		return ringspans(_buffer, LEN, int(position % LEN), count);
+	}
+
+	// length samples starting delay samples before the end of extent,
+	// zeros before the oldest sample like RingBufferImpl::delayspans
+	Spans delayspans(const RingExtent& extent, int delay, int length) const {
+		int u = int(extent.end - extent.start);
+
+		if(delay > u) {
+			int zeros = delay - u;
+			if(zeros > length)
+				zeros = length;
+			int count = length - zeros;
+			if(count > u)
+				count = u;
+
+			Spans s = spans(extent.start, count);
+			s.zeros = zeros;
+			return s;
+		}
+
+		if(length > delay)
+			length = delay;
+
+		return spans(extent.end - delay, length);
+	}
+
+private:
+	const T* _buffer;
+	const volatile RingIndex& _index;
+	int _guard;
+};
 
 template<typename T, int LEN> class RingBufferStaticBuffer {
 public:
@@ -54,21 +253,23 @@ public:
 template<typename Parent, typename T, int LEN> class RingBufferImpl : public Parent {
 public:
 
+	typedef RingSpans<const T> Spans;
+
 	class RingRange {
-	public:
-
-		RingRange()
-		{
+	public:
+
+		RingRange()
+		{
 		}
 
 		RingRange(T const* buffer, int const start, int const * const end, int const delay)
-		  : _zero(0)
+		  : _zero(0)
 		{
 			_buffer = const_cast<T*>(buffer);
-			_pos = start;
+			_pos = start;
 			_end = end;
-			_delay = delay;
-		}
+			_delay = delay;
+		}
 
 		bool isempty() const {
 			return (_pos == *_end);
@@ -199,7 +400,9 @@ public:
 		int _delay;
 	};
 
-	RingBufferImpl() {
+	RingBufferImpl()
+	  : _start(0), _end(0), _written(0)
+	{
 		reset();
 	}
 
@@ -260,7 +463,36 @@ public:
 		return RingRange(this->Buffer(), curstart, end, 0);
 	}
 
+	// zero-copy view of length samples starting delay samples before the
+	// end, same samples as delayrange(delay) walks
+	Spans delayspans(int delay, int length) const {
+		int u = used();
+
+		if(delay > u) {
+			int zeros = delay - u;
+			if(zeros > length)
+				zeros = length;
+			int count = length - zeros;
+			if(count > u)
+				count = u;
+
+			Spans spans = ringspans(this->Buffer(), LEN, _start, count);
+			spans.zeros = zeros;
+			return spans;
+		}
+
+		int curstart = _end - delay;
+		if(curstart < 0)
+			curstart += LEN;
+		if(length > delay)
+			length = delay;
+
+		return ringspans(this->Buffer(), LEN, curstart, length);
+	}
+
 	void reset() {
+		// keep positions monotonic and in step with the indices
+		_written += (LEN - _end) % LEN;
 		_start = _end = 0;
 	}
 
@@ -280,6 +512,23 @@ public:
 		return LEN - used();
 	}
 
+	// samples ever inserted
+	uint64_t written() const {
+		return _written;
+	}
+
+	RingExtent extent() const {
+		RingExtent e;
+		e.start = _written - used();
+		e.end = _written;
+		return e;
+	}
+
+	// make everything inserted so far visible to RingReaders
+	void publish(volatile RingIndex& index) const {
+		index.publish(extent());
+	}
+
 	void insert(T value) {
 		if ((_end + 1 != _start) && (_end + 1 - LEN != _start)) {
 			int prevend = _end;
@@ -289,6 +538,7 @@ public:
 			}
 			this->Buffer()[prevend] = value;
 			_end = end;
+			_written++;
 		}
 	}
 
@@ -297,6 +547,7 @@ public:
 		int f = free();
 		if(f < numsamples) numsamples = f;
 		if(numsamples < 1) return;
+		_written += numsamples;
 
 		if(_end + numsamples >= LEN) {
 			memset(&this->Buffer()[_end], 0, (LEN - _end) * sizeof(T));
@@ -321,6 +572,7 @@ public:
 		int f = free();
 		if(f < numsamples) numsamples = f;
 		if(numsamples < 1) return;
+		_written += numsamples;
 
 		if(_end + numsamples >= LEN) {
 			numsamples -= LEN - _end;
@@ -349,6 +601,7 @@ public:
 		int f = free();
 		if(f < numsamples) numsamples = f;
 		if(numsamples < 1) return;
+		_written += numsamples;
 
 		if(stride == 1) {
 			if(_end + numsamples >= LEN) {
@@ -397,6 +650,7 @@ public:
 		int f = free();
 		if(f < numsamples) numsamples = f;
 		if(numsamples < 1) return 0;
+		_written += numsamples;
 
 		T* ptr = &this->Buffer()[_end];
 
@@ -425,20 +679,20 @@ public:
 
 	const T* oldestPtr() const {
 		return &this->Buffer()[_start];
-	}
-
-	T oldest() const {
-		return *oldestPtr();
-	}
+	}
+
+	T oldest() const {
+		return *oldestPtr();
+	}
 
 	const T* latestPtr() const {
 		int i = _end - 1;
 		if (i < 0) i += LEN;
 		return &this->Buffer()[i];
 	}
-
+
 	T latest() const {
-		return *latestPtr();
+		return *latestPtr();
 	}
 
 	void get(T *out, int numsamples) {
@@ -512,6 +766,7 @@ public:
 
 protected:
 	int _start, _end;
+	uint64_t _written;
 };
 
 template <typename T, int LEN>
@@ -1,3 +1,6 @@
+#include <math.h>
+#include <stdint.h>
+#include <string.h>
 #include <algorithm>
 
 namespace {
@@ -16,17 +19,267 @@ namespace {
 			-0.000766990298871, -0.000383495178539, -0.000191747603822,
 			-0.000095873801911, };
 
+	// quarter wave sine table, sintab[k] = sin(2*pi*k/tablesize), k = 0..tablesize/4
+	float *sintab = 0;
+	int tablesizelog2 = 0;
+
+	// w = exp(-j*2*pi*a/tablesize), 0 <= a < tablesize
+	inline void twiddle(int a, float& wr, float& wi)
+	{
+		int quartershift = tablesizelog2 - 2;
+		int quarter = 1 << quartershift;
+		int r = a & (quarter - 1);
+
+		switch (a >> quartershift) {
+		case 0:
+			wr = sintab[quarter - r];
+			wi = -sintab[r];
+			break;
+		case 1:
+			wr = -sintab[r];
+			wi = -sintab[quarter - r];
+			break;
+		case 2:
+			wr = -sintab[quarter - r];
+			wi = sintab[r];
+			break;
+		default:
+			wr = sintab[r];
+			wi = sintab[quarter - r];
+			break;
+		}
+	}
+
+	void bitreverse_loop(float *re, float *im, int m)
+	{
+		int i=1;
+		int n=2<<m;
+		int nm1=n-1;
+		int nd2=n>>1;
+		int j=nd2;
+		int k;
+
+		float tr,ti;
+
+		for (;i<nm1;) {
+
+			int count = std::min(nm1 - i, 256);
+			for (; count--; i++) {
+				if(i < j) {
+					// rotate
+					tr=re[j];
+					ti=im[j];
+					re[j]=re[i];
+					im[j]=im[i];
+					re[i]=tr;
+					im[i]=ti;
+				}
+
+				k=nd2;
+
+				while (k <= j) {
+					j=j-k;
+					k=k>>1;
+				}
+
+				j=j+k;
+			}
+		}
+	}
+
+
+	// swap pair tables for bit reversal, i | (j << 16) with i < j
+	uint32_t *bitrevmem = 0;
+	uint32_t *bitrevend = 0;
+	const uint32_t *bitrevpairs[32];
+
+	int bitrevcount(int nlog2)
+	{
+		// indices that are their own reversal stay in place
+		return ((1 << nlog2) - (1 << ((nlog2+1)>>1))) >> 1;
+	}
+
+	// the table for a size, fft_init builds them all up front
+	const uint32_t* bitrevtable(int m)
+	{
+		int nlog2=m+1;
+
+		if (bitrevpairs[nlog2] || nlog2 > 16) {
+			return bitrevpairs[nlog2];
+		}
+
+		int count=bitrevcount(nlog2);
+		if (bitrevmem + count > bitrevend) {
+			return 0;
+		}
+
+		uint32_t *pairs=bitrevmem;
+		bitrevmem+=count;
+
+		int n=1<<nlog2;
+		int nd2=n>>1;
+		int j=nd2;
+		int p=0;
+
+		for (int i=1;i<n-1;i++) {
+			if (i < j) {
+				pairs[p++]=i | (j << 16);
+			}
+
+			int k=nd2;
+			while (k <= j) {
+				j=j-k;
+				k=k>>1;
+			}
+			j=j+k;
+		}
+
+		bitrevpairs[nlog2]=pairs;
+		return pairs;
+	}
+
+	void bitreverse(float *re, float *im, int m)
+	{
+		const uint32_t *pairs=bitrevtable(m);
+		if (!pairs) {
+			bitreverse_loop(re,im,m);
+			return;
+		}
+
+		float tr,ti;
+
+		for (int count=bitrevcount(m+1); count--; pairs++) {
+			uint32_t pair=*pairs;
+			int i=pair & 0xffff;
+			int j=pair >> 16;
+
+			tr=re[j];
+			ti=im[j];
+			re[j]=re[i];
+			im[j]=im[i];
+			re[i]=tr;
+			im[i]=ti;
+		}
+	}
 }
 
+// Tables are placed in mem: the twiddle table first, then the bit
+// reversal swap tables of every size up to 2 << maxm.
+void fft_init(void *mem, int memsize, int maxm)
+{
+	float *table = (float*)mem;
+
+	tablesizelog2 = maxm+1;
+	int quarter = 1 << (tablesizelog2 - 2);
+	double phasescale = 2*M_PI/double(1 << tablesizelog2);
+
+	for (int k=0;k<=quarter;k++) {
+		table[k] = sin(double(k) * phasescale);
+	}
+
+	// exact values at the ends of the quarter wave
+	table[0] = 0;
+	table[quarter] = 1;
+
+	sintab = table;
+
+	bitrevmem = (uint32_t*)&table[quarter+1];
+	bitrevend = (uint32_t*)((uint8_t*)mem + memsize);
+	memset(bitrevpairs, 0, sizeof(bitrevpairs));
+
+	// no table is built while an analysis or a benchmark runs
+	for (int m=0;m<=maxm;m++) {
+		bitrevtable(m);
+	}
+}
+
+// Memory needed for the twiddle table and the swap tables of all sizes
+int fft_tablesize(int maxm)
+{
+	int size = ((1 << (maxm+1)) / 4 + 1) * sizeof(float);
+	for (int nlog2=1;nlog2<=maxm+1;nlog2++) {
+		size += bitrevcount(nlog2) * sizeof(uint32_t);
+	}
+	return size;
+}
 
 void fft(float *re, float *im, int m)
 {
-	int i=1;
+	int n=2<<m;
+	int stages=m+1;
+	int l=1;
+
+	bitreverse(re,im,m);
+
+	// odd number of stages: do the first one as radix-2
+	if (stages & 1) {
+		for (int i=0;i<n;i+=2) {
+			float tr=re[i+1];
+			float ti=im[i+1];
+			re[i+1]=re[i]-tr;
+			im[i+1]=im[i]-ti;
+			re[i]=re[i]+tr;
+			im[i]=im[i]+ti;
+		}
+		l=2;
+	}
+
+	// radix-4 stages, each combines four transforms of length l
+	for (;l<n;l*=4) {
+		int le=4*l;
+		int stride=(1 << tablesizelog2) / le;
+
+		for (int j=0;j<l;j++) {
+			float w1r,w1i,w2r,w2i,w3r,w3i;
+			twiddle(j*stride, w1r, w1i);
+			twiddle(2*j*stride, w2r, w2i);
+			twiddle(3*j*stride, w3r, w3i);
+
+			for (int i=j;i<n;i+=le) {
+				int i1=i+l;
+				int i2=i1+l;
+				int i3=i2+l;
+
+				// inputs are in bit reversed order: x0, x2, x1, x3
+				float t0r=re[i];
+				float t0i=im[i];
+				float t1r=re[i1]*w2r-im[i1]*w2i;
+				float t1i=re[i1]*w2i+im[i1]*w2r;
+				float t2r=re[i2]*w1r-im[i2]*w1i;
+				float t2i=re[i2]*w1i+im[i2]*w1r;
+				float t3r=re[i3]*w3r-im[i3]*w3i;
+				float t3i=re[i3]*w3i+im[i3]*w3r;
+
+				float s01r=t0r+t1r;
+				float s01i=t0i+t1i;
+				float d01r=t0r-t1r;
+				float d01i=t0i-t1i;
+				float s23r=t2r+t3r;
+				float s23i=t2i+t3i;
+				float d23r=t2r-t3r;
+				float d23i=t2i-t3i;
+
+				re[i]=s01r+s23r;
+				im[i]=s01i+s23i;
+				re[i1]=d01r+d23i;
+				im[i1]=d01i-d23r;
+				re[i2]=s01r-s23r;
+				im[i2]=s01i-s23i;
+				re[i3]=d01r-d23i;
+				im[i3]=d01i+d23r;
+			}
+		}
+	}
+}
+
+// Reference radix-2 transform with recursive twiddles, kept for benchmarking
+void fft_radix2(float *re, float *im, int m)
+{
+	int i;
 	int n=2<<m;
 	int nm1=n-1;
-	int nd2=n>>1;
-	int j=nd2;
-	int k,l=1;
+	int j;
+	int l=1;
 	int le;
 	int le2;
 	int jm1;
@@ -36,30 +289,7 @@ void fft(float *re, float *im, int m)
 	float ur,ui;
 	float sr,si;
 
-	for (;i<nm1;) {
-
-		int count = std::min(nm1 - i, 256);
-		for (; count--; i++) {
-			if(i < j) {
-				// rotate
-				tr=re[j];
-				ti=im[j];
-				re[j]=re[i];
-				im[j]=im[i];
-				re[i]=tr;
-				im[i]=ti;
-			}
-
-			k=nd2;
-
-			while (k <= j) {
-				j=j-k;
-				k=k>>1;
-			}
-
-			j=j+k;
-		}
-	}
+	bitreverse_loop(re,im,m);
 
 	for(;l<m+2;l++) {
 		le=2<<(l-1);
@@ -93,6 +323,158 @@ void fft(float *re, float *im, int m)
 	}
 }
 
+// Four-step transform for large sizes: column transforms, twiddle
+// multiply, row transforms and transpose. Tiles of the matrix are
+// copied to the work buffer (local SRAM), so the large memory is only
+// accessed in short sequential runs. The result goes to outre/outim,
+// re/im are used as intermediate storage. If abort is given it is polled
+// between tiles, and a transform it stops returns false.
+bool fft_fourstep(float *re, float *im, float *outre, float *outim, int m, float *work, int worksize, const volatile bool *abort)
+{
+	int nlog2=m+1;
+	int n=1<<nlog2;
+	int rowslog2=(nlog2+1)>>1;
+	int colslog2=nlog2-rowslog2;
+	int rows=1<<rowslog2;
+	int cols=1<<colslog2;
+	int tableshift=tablesizelog2-nlog2;
+
+	// columns: transform, twiddle, write back in place
+	int block=std::min(worksize/(2*rows), cols);
+
+	for (int c0=0;c0<cols;c0+=block) {
+		if (abort && *abort) {
+			return false;
+		}
+
+		for (int r=0;r<rows;r++) {
+			const float *srcre=&re[r*cols+c0];
+			const float *srcim=&im[r*cols+c0];
+			for (int b=0;b<block;b++) {
+				work[2*b*rows+r]=srcre[b];
+				work[(2*b+1)*rows+r]=srcim[b];
+			}
+		}
+
+		for (int b=0;b<block;b++) {
+			float *wre=&work[2*b*rows];
+			float *wim=&work[(2*b+1)*rows];
+			int c=c0+b;
+
+			fft(wre,wim,rowslog2-1);
+
+			for (int k=1;k<rows;k++) {
+				float wr,wi;
+				twiddle(((k*c)&(n-1))<<tableshift,wr,wi);
+				float tr=wre[k]*wr-wim[k]*wi;
+				float ti=wre[k]*wi+wim[k]*wr;
+				wre[k]=tr;
+				wim[k]=ti;
+			}
+		}
+
+		for (int r=0;r<rows;r++) {
+			float *dstre=&re[r*cols+c0];
+			float *dstim=&im[r*cols+c0];
+			for (int b=0;b<block;b++) {
+				dstre[b]=work[2*b*rows+r];
+				dstim[b]=work[(2*b+1)*rows+r];
+			}
+		}
+	}
+
+	// rows: transform, write out transposed
+	block=std::min(worksize/(2*cols), rows);
+
+	for (int r0=0;r0<rows;r0+=block) {
+		if (abort && *abort) {
+			return false;
+		}
+
+		for (int b=0;b<block;b++) {
+			float *wre=&work[2*b*cols];
+			float *wim=&work[(2*b+1)*cols];
+			memcpy(wre,&re[(r0+b)*cols],cols*sizeof(float));
+			memcpy(wim,&im[(r0+b)*cols],cols*sizeof(float));
+
+			fft(wre,wim,colslog2-1);
+		}
+
+		for (int k=0;k<cols;k++) {
+			float *dstre=&outre[k*rows+r0];
+			float *dstim=&outim[k*rows+r0];
+			for (int b=0;b<block;b++) {
+				dstre[b]=work[2*b*cols+k];
+				dstim[b]=work[(2*b+1)*cols+k];
+			}
+		}
+	}
+
+	return true;
+}
+
+// Separate the spectra of two real signals that were transformed
+// together as z = x + jy. z may share memory with the outputs.
+// Output: spectrum of x in re1/im1, y in re2/im2.
+void fft_real_split(const float *zre, const float *zim, float *re1, float *im1, float *re2, float *im2, int m)
+{
+	int n=2<<m;
+	int nd2=n>>1;
+
+	// X[k] = (Z[k] + Z*[n-k])/2, Y[k] = (Z[k] - Z*[n-k])/2j
+	// dc and nyquist bins are real
+	float dcr=zre[0];
+	float dci=zim[0];
+	float nyr=zre[nd2];
+	float nyi=zim[nd2];
+	re1[0]=dcr;
+	im1[0]=0;
+	re2[0]=dci;
+	im2[0]=0;
+	re1[nd2]=nyr;
+	im1[nd2]=0;
+	re2[nd2]=nyi;
+	im2[nd2]=0;
+
+	for (int k=1;k<nd2;) {
+
+		int count = std::min(nd2 - k, 256);
+		for (; count--; k++) {
+			int nk=n-k;
+
+			float ar=zre[k];
+			float ai=zim[k];
+			float br=zre[nk];
+			float bi=zim[nk];
+
+			float xr=0.5f*(ar+br);
+			float xi=0.5f*(ai-bi);
+			float yr=0.5f*(ai+bi);
+			float yi=0.5f*(br-ar);
+
+			re1[k]=xr;
+			im1[k]=xi;
+			re1[nk]=xr;
+			im1[nk]=-xi;
+
+			re2[k]=yr;
+			im2[k]=yi;
+			re2[nk]=yr;
+			im2[nk]=-yi;
+		}
+	}
+}
+
+// Transform two real signals with one complex FFT.
+// Input: real signals in re1 and re2, im1 and im2 are overwritten.
+// Output: spectrum of the first signal in re1/im1, second in re2/im2.
+void fft_real_pair(float *re1, float *im1, float *re2, float *im2, int m)
+{
+	// pack as z = x + jy
+	fft(re1,re2,m);
+	fft_real_split(re1,re2,re1,im1,re2,im2,m);
+}
+
 void inverse_fft(float *re, float *im, int m)
 {
 	int n=2<<m;
@@ -1,6 +1,13 @@
 #ifndef FFT_H_
 #define FFT_H_
 
+void fft_init(void *mem, int memsize, int maxm);
+int fft_tablesize(int maxm);
+
 void fft(float *re, float *im, int m);
+void fft_radix2(float *re, float *im, int m);
+bool fft_fourstep(float *re, float *im, float *outre, float *outim, int m, float *work, int worksize, const volatile bool *abort = 0);
+void fft_real_split(const float *zre, const float *zim, float *re1, float *im1, float *re2, float *im2, int m);
+void fft_real_pair(float *re1, float *im1, float *re2, float *im2, int m);
 
 #endif /* FFT_H_ */
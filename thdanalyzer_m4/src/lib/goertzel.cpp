@@ -0,0 +1,51 @@
+#include <math.h>
+#include <algorithm>
+
+#include "goertzel.h"
+
+// Power |X[k]|^2 of the n point DFT of x at the given bins.
+// Bins are run four at a time so each sample is loaded once per group.
+void goertzel_bank(const float *x, int n, const int *bins, int numbins, float *power)
+{
+	for (int b=0;b<numbins;b+=4) {
+		int count=std::min(numbins-b, 4);
+
+		float c[4]={0, 0, 0, 0};
+		for (int j=0;j<count;j++) {
+			c[j]=2.0*cos(2*M_PI*double(bins[b+j])/double(n));
+		}
+
+		float s1a=0,s2a=0;
+		float s1b=0,s2b=0;
+		float s1c=0,s2c=0;
+		float s1d=0,s2d=0;
+
+		for (int i=0;i<n;i++) {
+			float v=x[i];
+			float s;
+
+			s=v+c[0]*s1a-s2a;
+			s2a=s1a;
+			s1a=s;
+
+			s=v+c[1]*s1b-s2b;
+			s2b=s1b;
+			s1b=s;
+
+			s=v+c[2]*s1c-s2c;
+			s2c=s1c;
+			s1c=s;
+
+			s=v+c[3]*s1d-s2d;
+			s2d=s1d;
+			s1d=s;
+		}
+
+		float s1[4]={s1a, s1b, s1c, s1d};
+		float s2[4]={s2a, s2b, s2c, s2d};
+		for (int j=0;j<count;j++) {
+			float p=s1[j]*s1[j]+s2[j]*s2[j]-c[j]*s1[j]*s2[j];
+			power[b+j]=std::max(p, 0.0f);
+		}
+	}
+}
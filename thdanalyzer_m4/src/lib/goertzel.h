@@ -0,0 +1,6 @@
+#ifndef GOERTZEL_H_
+#define GOERTZEL_H_
+
+void goertzel_bank(const float *x, int n, const int *bins, int numbins, float *power);
+
+#endif /* GOERTZEL_H_ */
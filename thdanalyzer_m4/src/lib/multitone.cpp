@@ -0,0 +1,127 @@
+#include <math.h>
+#include <stdint.h>
+
+#include "multitone.h"
+
+namespace {
+
+	// one period of sine, sintab[k] = sin(2*pi*k/MULTITONELENGTH)
+	float *sintab = 0;
+	int bins[MULTITONETONES];
+	float phasecos[MULTITONETONES];
+	float phasesin[MULTITONETONES];
+	float peakinv = 0;
+
+	// Sample i of the unscaled sum
+	float sample(int i)
+	{
+		float sum = 0;
+		for (int k = 0; k < MULTITONETONES; k++) {
+			int j = (bins[k] * i) & (MULTITONELENGTH-1);
+			float s = sintab[j];
+			float c = sintab[(j + MULTITONELENGTH/4) & (MULTITONELENGTH-1)];
+			sum += s * phasecos[k] + c * phasesin[k];
+		}
+
+		return sum;
+	}
+
+}
+
+void multitone_init(void *mem, int memsize)
+{
+	if (memsize < MULTITONEMEMSIZE) {
+		return;
+	}
+
+	sintab = (float*)mem;
+	double phasescale = 2*M_PI / double(MULTITONELENGTH);
+	for (int k = 0; k < MULTITONELENGTH; k++) {
+		sintab[k] = sin(double(k) * phasescale);
+	}
+
+	// log spaced, but never two tones in one bin
+	float topbin = MULTITONETOP * MULTITONELENGTH;
+	float ratio = powf(topbin / MULTITONELOWBIN, 1.0f / (MULTITONETONES - 1));
+	int previous = 0;
+	for (int k = 0; k < MULTITONETONES; k++) {
+		int bin = int(MULTITONELOWBIN * powf(ratio, float(k)) + 0.5f);
+		if (bin <= previous) {
+			bin = previous + 1;
+		}
+		bins[k] = bin;
+		previous = bin;
+
+		// start from Schroeder phases
+		float phase = -M_PI * float(k) * float(k) / float(MULTITONETONES);
+		phasecos[k] = cosf(phase);
+		phasesin[k] = sinf(phase);
+	}
+
+	// then clip the sum and fit the phases to what is left, keeping the
+	// phases of the lowest peak seen
+	float limit = MULTITONECLIP * sqrtf(0.5f * MULTITONETONES);
+	float bestpeak = 0;
+	float bestcos[MULTITONETONES];
+	float bestsin[MULTITONETONES];
+	for (int pass = 0; pass <= MULTITONEITERATIONS; pass++) {
+		float re[MULTITONETONES] = { 0 };
+		float im[MULTITONETONES] = { 0 };
+		float peak = 0;
+
+		for (int i = 0; i < MULTITONELENGTH; i++) {
+			float x = sample(i);
+			peak = fmaxf(peak, fabsf(x));
+			x = fminf(fmaxf(x, -limit), limit);
+
+			for (int k = 0; k < MULTITONETONES; k++) {
+				int j = (bins[k] * i) & (MULTITONELENGTH-1);
+				re[k] += x * sintab[j];
+				im[k] += x * sintab[(j + MULTITONELENGTH/4) & (MULTITONELENGTH-1)];
+			}
+		}
+
+		if (pass == 0 || peak < bestpeak) {
+			bestpeak = peak;
+			for (int k = 0; k < MULTITONETONES; k++) {
+				bestcos[k] = phasecos[k];
+				bestsin[k] = phasesin[k];
+			}
+		}
+
+		for (int k = 0; k < MULTITONETONES; k++) {
+			float a = hypotf(re[k], im[k]);
+			phasecos[k] = re[k] / a;
+			phasesin[k] = im[k] / a;
+		}
+	}
+
+	for (int k = 0; k < MULTITONETONES; k++) {
+		phasecos[k] = bestcos[k];
+		phasesin[k] = bestsin[k];
+	}
+	peakinv = 1.0f / bestpeak;
+}
+
+int multitone_bin(int tone)
+{
+	return bins[tone];
+}
+
+float multitone_phase(int tone)
+{
+	return atan2f(phasesin[tone], phasecos[tone]);
+}
+
+float multitone_amplitude()
+{
+	return peakinv;
+}
+
+void multitone_render(int32_t *out, float scale)
+{
+	float gain = scale * peakinv;
+	for (int i = 0; i < MULTITONELENGTH; i++) {
+		out[i] = int32_t(sample(i) * gain);
+	}
+}
@@ -0,0 +1,31 @@
+#ifndef MULTITONE_H_
+#define MULTITONE_H_
+
+#include <stdint.h>
+
+// One period of the multitone stimulus, in frames
+#define MULTITONELENGTHLOG2 12
+#define MULTITONELENGTH (1 << MULTITONELENGTHLOG2)
+// Log spaced tones from bin MULTITONELOWBIN up to the MULTITONETOP
+// fraction of the sample rate
+#define MULTITONETONES 31
+#define MULTITONELOWBIN 2
+#define MULTITONETOP 0.42f
+#define MULTITONEMEMSIZE (MULTITONELENGTH * 4)
+// Phase refinement passes, clipping the sum at MULTITONECLIP times its rms
+#define MULTITONEITERATIONS 40
+#define MULTITONECLIP 1.2f
+
+void multitone_init(void *mem, int memsize);
+
+// Bin of a tone in a transform of one period, increasing with the tone
+int multitone_bin(int tone);
+// Phase of a tone, as sin(2*pi*bin*i/length + phase)
+float multitone_phase(int tone);
+// Amplitude of each tone when the sum peaks at 1
+float multitone_amplitude();
+
+// One period of the sum, peaking at scale
+void multitone_render(int32_t *out, float scale);
+
+#endif /* MULTITONE_H_ */
@@ -0,0 +1,86 @@
+#include <math.h>
+#include <stdint.h>
+
+#include "settle.h"
+
+namespace {
+
+	bool steady(float a, float b, float tolerance, float floor)
+	{
+		float larger = a > b ? a : b;
+		return fabsf(a - b) <= tolerance * larger + floor;
+	}
+
+}
+
+void settle_start(SettleState& s)
+{
+	s.rms0 = 0;
+	s.rms1 = 0;
+	s.mean0 = 0;
+	s.mean1 = 0;
+	s.previous = false;
+	s.sum0 = 0;
+	s.sum1 = 0;
+	s.squares0 = 0;
+	s.squares1 = 0;
+	s.count = 0;
+}
+
+void settle_run(SettleState& s, const int32_t *in, int pairs)
+{
+	float mean0 = s.mean0;
+	float mean1 = s.mean1;
+	float sum0 = s.sum0;
+	float sum1 = s.sum1;
+	float squares0 = s.squares0;
+	float squares1 = s.squares1;
+
+	for (int i=0;i<pairs;i++) {
+		float x0 = float(in[0]) - mean0;
+		float x1 = float(in[1]) - mean1;
+		sum0 += x0;
+		sum1 += x1;
+		squares0 += x0 * x0;
+		squares1 += x1 * x1;
+		in += 2;
+	}
+
+	s.sum0 = sum0;
+	s.sum1 = sum1;
+	s.squares0 = squares0;
+	s.squares1 = squares1;
+	s.count += pairs;
+}
+
+// Close the block summed since the last call. True if it is steady
+// against the block before it, floor is the change allowed at any level.
+bool settle_finish(SettleState& s, float tolerance0, float tolerance1, float floor)
+{
+	if (s.count == 0) {
+		return false;
+	}
+
+	float n = float(s.count);
+	float offset0 = s.sum0 / n;
+	float offset1 = s.sum1 / n;
+	float rms0 = sqrtf(fmaxf(s.squares0 / n - offset0 * offset0, 0.0f));
+	float rms1 = sqrtf(fmaxf(s.squares1 / n - offset1 * offset1, 0.0f));
+
+	bool result = s.previous
+		&& steady(rms0, s.rms0, tolerance0, floor)
+		&& steady(rms1, s.rms1, tolerance1, floor);
+
+	s.rms0 = rms0;
+	s.rms1 = rms1;
+	s.mean0 += offset0;
+	s.mean1 += offset1;
+	s.previous = true;
+	s.sum0 = 0;
+	s.sum1 = 0;
+	s.squares0 = 0;
+	s.squares1 = 0;
+	s.count = 0;
+
+	return result;
+}
@@ -0,0 +1,28 @@
+#ifndef SETTLE_H_
+#define SETTLE_H_
+
+#include <stdint.h>
+
+// Envelope of interleaved pairs block by block. A block is steady when
+// the rms of both channels is within tolerance of the previous block's.
+struct SettleState
+{
+	// the last finished block
+	float rms0;
+	float rms1;
+	float mean0;
+	float mean1;
+	bool previous;
+	// the block being summed, about the last block's means
+	float sum0;
+	float sum1;
+	float squares0;
+	float squares1;
+	int count;
+};
+
+void settle_start(SettleState& s);
+void settle_run(SettleState& s, const int32_t *in, int pairs);
+bool settle_finish(SettleState& s, float tolerance0, float tolerance1, float floor);
+
+#endif /* SETTLE_H_ */
@@ -0,0 +1,270 @@
+#include <math.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "window.h"
+
+namespace {
+
+	const int maxsizelog2 = 16;
+
+	// cosine series coefficients, w = sum (-1)^k c[k] cos(k*phase)
+	const double flattop[] = { 1.0, 1.93, 1.29, 0.388, 0.028 };
+	const double hann[] = { 0.5, 0.5 };
+	const double blackmanharris4[] = { 0.35875, 0.48829, 0.14128, 0.01168 };
+	const double blackmanharris7[] = { 0.27105140069342, 0.43329793923448, 0.21812299954311,
+			0.06592544638803, 0.01081174209837, 0.00077658482522, 0.00001388721735 };
+	const double rectangular[] = { 1.0 };
+
+	// Bisection steps for the tone offset, to about 1e-6 bins
+	const int interpolationsteps = 20;
+
+	struct WindowShape
+	{
+		const double *coeffs;
+		int numcoeffs;
+		// main lobe half width in bins
+		int lobewidth;
+	};
+
+	const WindowShape shapes[WindowKinds] = {
+		{ flattop, 5, 5 },
+		{ hann, 2, 2 },
+		{ blackmanharris4, 4, 4 },
+		{ blackmanharris7, 7, 7 },
+		{ rectangular, 1, 1 },
+	};
+
+	struct WindowTable
+	{
+		const float *half;
+		float gain;
+		float enbw;
+	};
+
+	// half tables are allocated from the window memory as they get used
+	float *windowstart = 0;
+	float *windowmem = 0;
+	float *windowend = 0;
+	WindowTable tables[WindowKinds][maxsizelog2+1];
+
+	void build(const WindowShape& shape, float *half, int n, WindowTable& table)
+	{
+		double phasescale = 2*M_PI/(double(n) - 1.0);
+		double sum = 0;
+		double sumsquares = 0;
+
+		for (int i=0;i<n/2;i++) {
+			double c1 = cos(double(i) * phasescale);
+			double ck = 1;
+			double ckm1 = c1;
+			double w = 0;
+			double sign = 1;
+
+			// cos(k*phase) by the Chebyshev recurrence
+			for (int k=0;k<shape.numcoeffs;k++) {
+				w += sign * shape.coeffs[k] * ck;
+				double next = k == 0 ? c1 : 2*c1*ck - ckm1;
+				ckm1 = ck;
+				ck = next;
+				sign = -sign;
+			}
+
+			half[i] = w;
+			sum += 2*w;
+			sumsquares += 2*w*w;
+		}
+
+		table.half = half;
+		table.gain = float(sum / n);
+		table.enbw = float(n * sumsquares / (sum * sum));
+	}
+
+	const WindowTable* lookup(WindowKind kind, int sizelog2)
+	{
+		if (kind < 0 || kind >= WindowKinds || sizelog2 < 1 || sizelog2 > maxsizelog2) {
+			return 0;
+		}
+
+		WindowTable& table = tables[kind][sizelog2];
+		if (table.half) {
+			return &table;
+		}
+
+		int n = 1 << sizelog2;
+		if (windowmem + n/2 > windowend) {
+			// out of room: drop every table and start over
+			memset(tables, 0, sizeof(tables));
+			windowmem = windowstart;
+			if (windowmem + n/2 > windowend) {
+				return 0;
+			}
+		}
+
+		float *half = windowmem;
+		windowmem += n/2;
+
+		build(shapes[kind], half, n, table);
+		return &table;
+	}
+
+}
+
+void window_init(void *mem, int memsize)
+{
+	windowstart = (float*)mem;
+	windowmem = windowstart;
+	windowend = (float*)((uint8_t*)mem + memsize);
+	memset(tables, 0, sizeof(tables));
+}
+
+// Tables stay valid until the window memory fills up and is reused
+const float *window_table(WindowKind kind, int sizelog2)
+{
+	const WindowTable *table = lookup(kind, sizelog2);
+	return table ? table->half : 0;
+}
+
+// Mean of the window, the amplitude gain for a tone on a bin
+float window_gain(WindowKind kind, int sizelog2)
+{
+	const WindowTable *table = lookup(kind, sizelog2);
+	return table ? table->gain : 1;
+}
+
+// Equivalent noise bandwidth in bins
+float window_enbw(WindowKind kind, int sizelog2)
+{
+	const WindowTable *table = lookup(kind, sizelog2);
+	return table ? table->enbw : 1;
+}
+
+int window_lobewidth(WindowKind kind)
+{
+	if (kind < 0 || kind >= WindowKinds) {
+		return 1;
+	}
+	return shapes[kind].lobewidth;
+}
+
+// The centered window is sum c[k] cos(k*phase), so its response is a
+// sinc for c[0] and a pair of sincs k bins off either side for the rest.
+// sin(pi*(x-k)) is +-sin(pi*x), one sine does for all of them.
+float window_response(WindowKind kind, float offset)
+{
+	float x = fabsf(offset);
+	if (kind < 0 || kind >= WindowKinds) {
+		kind = WindowRectangular;
+	}
+	const WindowShape& shape = shapes[kind];
+
+	float s = sinf(float(M_PI) * x) / float(M_PI);
+	float sum = 0;
+	float sign = 1;
+	for (int k=0;k<shape.numcoeffs;k++) {
+		float c = float(shape.coeffs[k]);
+		float below = x - float(k);
+		float above = x + float(k);
+		float sincbelow = fabsf(below) < 1e-6f ? 1 : sign * s / below;
+		float sincabove = sign * s / above;
+		if (k == 0) {
+			sum += c * (x < 1e-6f ? 1 : s / x);
+		}
+		else {
+			sum += 0.5f * c * (sincbelow + sincabove);
+		}
+		sign = -sign;
+	}
+
+	return sum / float(shape.coeffs[0]);
+}
+
+// The larger neighbour is on the side of the tone, and its ratio to the
+// peak bin, W(1-d)/W(d), rises with the offset d from W(1) to 1 at half
+// a bin
+float window_interpolate(WindowKind kind, float left, float center, float right, float& amplitude)
+{
+	if (center <= 0) {
+		amplitude = 0;
+		return 0;
+	}
+
+	float side = right > left ? 1.0f : -1.0f;
+	float ratio = (right > left ? right : left) / center;
+
+	float lo = 0;
+	float hi = 0.5f;
+	for (int i=0;i<interpolationsteps;i++) {
+		float d = 0.5f * (lo + hi);
+		if (window_response(kind, 1.0f - d) < ratio * window_response(kind, d)) {
+			lo = d;
+		}
+		else {
+			hi = d;
+		}
+	}
+
+	float d = 0.5f * (lo + hi);
+	amplitude = center / window_response(kind, d);
+	return side * d;
+}
+
+// x[i] *= w[i], mirroring the half table
+void window_apply(float *x, const float *halfwindow, int n)
+{
+	float *tail = &x[n-1];
+
+	for (int i=0;i<n/2;i++) {
+		float w = halfwindow[i];
+		x[i] *= w;
+		*tail *= w;
+		tail--;
+	}
+}
+
+// out[i] = (in[i] - mean) * w[i], mirroring the half table
+void window_split(const int32_t *in, int pairs, int offset, float *out0, float *out1,
+		float mean0, float mean1, const float *halfwindow, int n)
+{
+	int half = n/2;
+	out0 += offset;
+	out1 += offset;
+
+	while (pairs > 0) {
+		// weights run forward over the first half and back over the second
+		int run;
+		const float *w;
+		int step;
+		if (offset < half) {
+			run = half - offset < pairs ? half - offset : pairs;
+			w = &halfwindow[offset];
+			step = 1;
+		}
+		else {
+			run = pairs;
+			w = &halfwindow[n-1-offset];
+			step = -1;
+		}
+
+		if (in) {
+			for (int i = 0; i < run; i++) {
+				float a = float(in[0]);
+				float b = float(in[1]);
+				in += 2;
+				*out0++ = (a - mean0) * *w;
+				*out1++ = (b - mean1) * *w;
+				w += step;
+			}
+		}
+		else {
+			for (int i = 0; i < run; i++) {
+				*out0++ = -mean0 * *w;
+				*out1++ = -mean1 * *w;
+				w += step;
+			}
+		}
+
+		offset += run;
+		pairs -= run;
+	}
+}
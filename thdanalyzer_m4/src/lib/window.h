@@ -0,0 +1,39 @@
+#ifndef WINDOW_H_
+#define WINDOW_H_
+
+#include <stdint.h>
+
+enum WindowKind
+{
+	WindowFlatTop = 0,
+	WindowHann = 1,
+	WindowBlackmanHarris4 = 2,
+	WindowBlackmanHarris7 = 3,
+	WindowRectangular = 4,
+	WindowKinds
+};
+
+void window_init(void *mem, int memsize);
+
+// First half of the symmetric window, w[n-1-i] == w[i]
+const float *window_table(WindowKind kind, int sizelog2);
+float window_gain(WindowKind kind, int sizelog2);
+float window_enbw(WindowKind kind, int sizelog2);
+int window_lobewidth(WindowKind kind);
+
+// Amplitude response offset bins away from a tone, 1 on the tone
+float window_response(WindowKind kind, float offset);
+// Offset of a tone from the peak bin, in bins, from the magnitudes of the
+// peak bin and its neighbours. amplitude is the peak magnitude corrected
+// for the window response at that offset.
+float window_interpolate(WindowKind kind, float left, float center, float right, float& amplitude);
+
+void window_apply(float *x, const float *halfwindow, int n);
+
+// Split interleaved pairs from in, or zeros if in is null, into points
+// offset..offset+pairs-1 of two n point frames, removing the means and
+// windowing on the way
+void window_split(const int32_t *in, int pairs, int offset, float *out0, float *out1,
+		float mean0, float mean1, const float *halfwindow, int n);
+
+#endif /* WINDOW_H_ */
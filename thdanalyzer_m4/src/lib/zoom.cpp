@@ -0,0 +1,167 @@
+#include <math.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "zoom.h"
+
+namespace {
+
+	float *filtermem = 0;
+	int filtermemsize = 0;
+	int filterlog2 = -1;
+
+	// Blackman-Harris windowed sinc cut off at 3/8 of the decimated rate,
+	// stored phase major: tap p + j*factor is at [p*ZOOMTAPSPERPHASE + j].
+	// Tones folding into the band come out about 125 dB below one in it,
+	// see test/zoom_test.cpp.
+	const float *filter(int factorlog2)
+	{
+		if (factorlog2 == filterlog2) {
+			return filtermem;
+		}
+
+		int factor = 1 << factorlog2;
+		int taps = ZOOMTAPSPERPHASE * factor;
+		if (factorlog2 < 0 || factorlog2 > ZOOMMAXFACTORLOG2 || taps * int(sizeof(float)) > filtermemsize) {
+			return 0;
+		}
+
+		float cutoff = 0.375f / float(factor);
+		float center = 0.5f * float(taps - 1);
+		float phasescale = 2*M_PI / float(taps - 1);
+		double sum = 0;
+
+		for (int i=0;i<taps;i++) {
+			// taps is even, so t is never zero
+			float t = float(i) - center;
+			float x = 2*M_PI * cutoff * t;
+			float phase = float(i) * phasescale;
+			float w = 0.35875f - 0.48829f * cosf(phase) + 0.14128f * cosf(2*phase) - 0.01168f * cosf(3*phase);
+			float h = sinf(x) / x * w;
+
+			filtermem[(i & (factor-1)) * ZOOMTAPSPERPHASE + (i >> factorlog2)] = h;
+			sum += h;
+		}
+
+		// unity gain at DC
+		float scale = float(1.0 / sum);
+		for (int i=0;i<taps;i++) {
+			filtermem[i] *= scale;
+		}
+
+		filterlog2 = factorlog2;
+		return filtermem;
+	}
+
+	void reverse(float *x, int n)
+	{
+		for (int i=0;i<n/2;i++) {
+			float t = x[i];
+			x[i] = x[n-1-i];
+			x[n-1-i] = t;
+		}
+	}
+
+}
+
+void zoom_init(void *mem, int memsize)
+{
+	filtermem = (float*)mem;
+	filtermemsize = memsize;
+	filterlog2 = -1;
+}
+
+// step is the mixer frequency in cycles per input sample, the means are
+// removed from the input before mixing
+void zoom_start(ZoomState& z, int factorlog2, double step, float mean0, float mean1)
+{
+	z.filter = filter(factorlog2);
+	z.factorlog2 = factorlog2;
+	z.step = step;
+	z.mean0 = mean0;
+	z.mean1 = mean1;
+	z.mixre = 1;
+	z.mixim = 0;
+	z.rotre = cosf(2*M_PI * step);
+	z.rotim = -sinf(2*M_PI * step);
+	z.inputs = 0;
+	z.outputs = 0;
+	memset(z.acc, 0, sizeof(z.acc));
+}
+
+// Mix pairs from in, or zeros if in is null, down by the mixer frequency
+// and low-pass them. Output m takes inputs m*factor on for
+// ZOOMTAPSPERPHASE*factor inputs, finished outputs are stored in order.
+void zoom_run(ZoomState& z, const int32_t *in, int pairs, float *re0, float *im0, float *re1, float *im1)
+{
+	int mask = (1 << z.factorlog2) - 1;
+
+	for (int i=0;i<pairs;i++) {
+		int n = z.inputs++;
+		int p = n & mask;
+		int block = n >> z.factorlog2;
+
+		if (p == 0) {
+			// exact mixer phase once per output, rotation in between
+			float phase = float(2*M_PI * fmod(z.step * double(n), 1.0));
+			z.mixre = cosf(phase);
+			z.mixim = -sinf(phase);
+		}
+
+		float x0 = -z.mean0;
+		float x1 = -z.mean1;
+		if (in) {
+			x0 += float(in[0]);
+			x1 += float(in[1]);
+			in += 2;
+		}
+
+		float re0x = x0 * z.mixre;
+		float im0x = x0 * z.mixim;
+		float re1x = x1 * z.mixre;
+		float im1x = x1 * z.mixim;
+
+		// every output whose window covers this input
+		const float *h = &z.filter[p * ZOOMTAPSPERPHASE];
+		int last = block < ZOOMTAPSPERPHASE-1 ? block : ZOOMTAPSPERPHASE-1;
+		for (int j=0;j<=last;j++) {
+			int slot = (block - j) & (ZOOMTAPSPERPHASE-1);
+			z.acc[0][slot] += h[j] * re0x;
+			z.acc[1][slot] += h[j] * im0x;
+			z.acc[2][slot] += h[j] * re1x;
+			z.acc[3][slot] += h[j] * im1x;
+		}
+
+		float mixre = z.mixre * z.rotre - z.mixim * z.rotim;
+		z.mixim = z.mixre * z.rotim + z.mixim * z.rotre;
+		z.mixre = mixre;
+
+		if (p == mask && block >= ZOOMTAPSPERPHASE-1) {
+			int slot = (block + 1) & (ZOOMTAPSPERPHASE-1);
+			int m = z.outputs++;
+			re0[m] = z.acc[0][slot];
+			im0[m] = z.acc[1][slot];
+			re1[m] = z.acc[2][slot];
+			im1[m] = z.acc[3][slot];
+			z.acc[0][slot] = 0;
+			z.acc[1][slot] = 0;
+			z.acc[2][slot] = 0;
+			z.acc[3][slot] = 0;
+		}
+	}
+}
+
+// After a mix down by a quarter of the rate, move bin k of the band to
+// index k: rotate the transform right by n/4
+void zoom_unshift(float *re, float *im, int n)
+{
+	int shift = n/4;
+
+	reverse(re, n);
+	reverse(re, shift);
+	reverse(&re[shift], n - shift);
+
+	reverse(im, n);
+	reverse(im, shift);
+	reverse(&im[shift], n - shift);
+}
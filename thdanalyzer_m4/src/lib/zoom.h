@@ -0,0 +1,36 @@
+#ifndef ZOOM_H_
+#define ZOOM_H_
+
+#include <stdint.h>
+
+// Decimation filter length in decimated samples
+#define ZOOMTAPSPERPHASE 32
+#define ZOOMMAXFACTORLOG2 9
+
+// Complex down-conversion and decimation of interleaved pairs
+struct ZoomState
+{
+	const float *filter;
+	int factorlog2;
+	// mixer frequency in cycles per input sample
+	double step;
+	float mean0;
+	float mean1;
+	float mixre;
+	float mixim;
+	float rotre;
+	float rotim;
+	// inputs taken and outputs made
+	int inputs;
+	int outputs;
+	// partial sums of the outputs still taking input
+	float acc[4][ZOOMTAPSPERPHASE];
+};
+
+void zoom_init(void *mem, int memsize);
+
+void zoom_start(ZoomState& z, int factorlog2, double step, float mean0, float mean1);
+void zoom_run(ZoomState& z, const int32_t *in, int pairs, float *re0, float *im0, float *re1, float *im1);
+void zoom_unshift(float *re, float *im, int n);
+
+#endif /* ZOOM_H_ */
@@ -3,6 +3,8 @@
 #endif
 
 #include <string.h>
+#include <stdlib.h>
+#include <cr_section_macros.h>
 
 #include "analyzer.h"
 #include "audio.h"
@@ -10,6 +12,18 @@
 #include "../common/sharedtypes.h"
 
 #include "../lib/fft.h"
+#include "../lib/goertzel.h"
+#include "../lib/window.h"
+#include "../lib/zoom.h"
+#include "../lib/multitone.h"
+#include "../lib/settle.h"
+#include "process.h"
+
+namespace {
+	// the I2S DMA interrupt appends to the ring while it is read here
+	typedef dsp::RingReader<int32_t, INPUTRINGLEN> InputReader;
+	InputReader inputReader((const int32_t*)INPUTRINGADDRESS, *inputIndex, INPUTRINGGUARD);
+}
 
 template <typename T>
 T min(T a, T b)
@@ -27,6 +41,20 @@ T max(T a, T b)
 		   : b;
 }
 
+__BSS(RamLoc40) float fftwork[FFTWORKSIZE];
+
+// Rough M4 cycle costs for choosing between the FFT and the harmonic
+// bank: FFT per point and radix-2 stage, FFT per point for windowing,
+// split and magnitudes, Goertzel per sample and bin
+#define FFTCYCLES 4
+#define FFTOVERHEADCYCLES 10
+#define GOERTZELCYCLES 3
+
+float binpower(const float *re, const float *im, int i)
+{
+	return re[i] * re[i] + im[i] * im[i];
+}
+
 int msb(unsigned int a)
 {
 	int bits = -1;
@@ -39,41 +67,109 @@ int msb(unsigned int a)
 }
 
 
-void Analyzer::SplitInput(float *resignal, float *refiltered, float& signalmean, float& filteredmean, int fftsize)
+// Add up count ring samples of whole pairs from position on
+static void PairSums(uint64_t position, int count, int64_t& signalsum, int64_t& filteredsum)
 {
-	__disable_irq();
-	InputRing::RingRange range = inputRing.delayrange(2*fftsize);
-	__enable_irq();
+	InputReader::Spans spans = inputReader.spans(position, count);
 
-	int64_t signalsum = 0;
-	int64_t filteredsum = 0;
-	for (int i = 0; i < fftsize; i++) {
-		int32_t value;
+	for (int s = 0; s < 2; s++) {
+		const int32_t *p = spans.ptr[s];
+		for (int i = spans.len[s]; i > 0; i -= 2) {
+			signalsum += p[0];
+			filteredsum += p[1];
+			p += 2;
+		}
+	}
+}
 
-		// get input signal, convert, store
-		value = range.value();
-		signalsum += value;
-		*resignal = value;
-		resignal++;
-		range.advance();
+// Sums of both channels over ring positions first..last-1, from the
+// writer's running sums and the partial blocks at either end
+static void InputSums(uint64_t first, uint64_t last, int64_t& signalsum, int64_t& filteredsum)
+{
+	uint64_t firstblock = first - first % INPUTSUMBLOCK;
+	uint64_t lastblock = last - last % INPUTSUMBLOCK;
 
-		// get filtered signal, convert, store
-		value = range.value();
-		filteredsum += value;
-		*refiltered = value;
-		refiltered++;
-		range.advance();
-	}
+	const InputSum& head = inputsum(firstblock);
+	const InputSum& tail = inputsum(lastblock);
+	signalsum = tail.signal - head.signal;
+	filteredsum = tail.filtered - head.filtered;
 
+	int64_t headsignal = 0;
+	int64_t headfiltered = 0;
+	PairSums(firstblock, int(first - firstblock), headsignal, headfiltered);
+	PairSums(lastblock, int(last - lastblock), signalsum, filteredsum);
+	signalsum -= headsignal;
+	filteredsum -= headfiltered;
+}
+
+// Whether the running sums used for first on are still there, the
+// writer reuses entries sooner than ring samples
+static bool InputSumsValid(uint64_t first)
+{
+	uint64_t firstblock = first - first % INPUTSUMBLOCK;
+	dsp::RingExtent extent = inputReader.extent();
+
+	return firstblock + INPUTSUMBLOCK * INPUTSUMENTRIES > extent.end + INPUTRINGGUARD;
+}
+
+// Read the block once into FFT memory, with the means removed and the
+// window applied. delay is the number of sample pairs between the end
+// of the block and the latest input.
+bool Analyzer::SplitInput(float *resignal, float *refiltered, float& signalmean, float& filteredmean, int fftsize, int delay)
+{
+	dsp::RingExtent extent = inputReader.extent();
+	int length = 2*(fftsize + delay);
+	InputReader::Spans spans = inputReader.delayspans(extent, length, 2*fftsize);
+
+	int held = int(extent.end - extent.start);
+	uint64_t first = extent.end - min(length, held);
+	uint64_t last = first + spans.len[0] + spans.len[1];
+
+	// samples before the oldest one count as zeros
+	int64_t signalsum;
+	int64_t filteredsum;
+	InputSums(first, last, signalsum, filteredsum);
+	splitposition = first;
 	signalmean = float(signalsum / fftsize);
 	filteredmean = float(filteredsum / fftsize);
+
+	const float *fftwindow = window_table(window, fftsizelog2);
+	int offset = 0;
+	window_split(0, spans.zeros/2, offset, resignal, refiltered, signalmean, filteredmean, fftwindow, fftsize);
+	offset += spans.zeros/2;
+	for (int s = 0; s < 2; s++) {
+		const int32_t *p = spans.ptr[s];
+		for (int pairs = spans.len[s]/2; pairs > 0; ) {
+			if (cancelled) {
+				return false;
+			}
+
+			int run = min(pairs, CANCELCHUNK);
+			window_split(p, run, offset, resignal, refiltered, signalmean, filteredmean, fftwindow, fftsize);
+			p += 2*run;
+			offset += run;
+			pairs -= run;
+		}
+	}
+
+	// false if the writer overwrote the block while it was read, or the
+	// analysis was cancelled
+	return inputReader.valid(first) && InputSumsValid(first);
 }
 
-void Analyzer::fftabs(float *re, float *im, int start, int end, float& maxvalue, int& maxindex, int fftsize)
+float Analyzer::fftscaling(int fftsize) const
 {
 	//float scaling_0dBu = sqrt((6.303352392838346e-25 * 65536.0 * 65536.0) / (2.11592368524*2.11592368524)) / float(fftsize);
 	float scaling_0dBu = 2.43089234e-8 / float(fftsize);
 	//float scaling_0dBu = 1.20438607134e-8 / float(fftsize);
+
+	// calibrated with the flat top window, which has unity gain
+	return scaling_0dBu / window_gain(window, msb(fftsize));
+}
+
+void Analyzer::fftabs(float *re, float *im, int start, int end, float& maxvalue, int& maxindex, int fftsize)
+{
+	float scaling_0dBu = fftscaling(fftsize);
 	float maxv = 0;
 	int maxi = 0;
 
@@ -99,66 +195,825 @@ void Analyzer::fftabs(float *re, float *im, int start, int end, float& maxvalue,
 	maxindex = maxi;
 }
 
-#define MAXFFTSIZELOG2 16
-#define MAXFFTSIZE (1 << MAXFFTSIZELOG2)
-
 void Analyzer::initwindow()
 {
-	for (int level = 16; level <= MAXFFTSIZE; level *= 2) {
+	window_init((void*)FFTWINDOWMEM, FFTWINDOWSIZE);
+}
 
-		float *fftwindow = (float*)(SDRAM_BASE_ADDR + 14*1048576 + level*4);
-		float phasescale = (2*M_PI/(float(level) - 1.0));
+void Analyzer::initfft()
+{
+	fft_init((void*)FFTTABLEMEM, FFTTABLESIZE, MAXFFTSIZELOG2-1);
+}
 
-		for (int i = 0; i < level; i++) {
-			//float w = 0.5 * (1.0 - cosf(float(i) * (2*M_PI/(FFTSIZE - 1.0))));
+void Analyzer::initzoom()
+{
+	zoom_init((void*)ZOOMFILTERMEM, ZOOMFILTERSIZE);
+}
 
-			float phase = float(i) * phasescale;
-			float w = 1
-					- 1.93 * cosf(phase)
-					+ 1.29 * cosf(2*phase)
-					- 0.388 * cosf(3*phase)
-					+ 0.028 * cosf(4*phase);
-			fftwindow[i] = w;
-		}
+// Shared result records start out without FlagValid
+void Analyzer::initresults()
+{
+	ClearResults();
+}
+
+// Shared results without FlagValid, for when they no longer describe the
+// configuration
+void Analyzer::ClearResults()
+{
+	AnalysisResult result;
+	memset(&result, 0, sizeof(result));
+	analysisResult.Store(result);
+
+	ResponseResult response;
+	memset(&response, 0, sizeof(response));
+	responseResult.Store(response);
+
+	*distortionLevel = fftabsvaluedb(0);
+	*distortionFrequency = 0;
+}
+
+void Analyzer::Configure(const GeneratorParameters& params)
+{
+	averagingmode = params._averagingmode;
+	averages = max(params._averages, 1);
+	overlap = min(max(params._overlap, 0.0f), 0.9f);
+	window = WindowKind(params._window);
+	zoom = params._zoom;
+	response = params._analysismode == GeneratorParameters::OperationModeFrequencyResponse;
+	level = params._level;
+	coherent = params._coherent && !response && params._analysismode != GeneratorParameters::OperationModeDCVoltageControl;
+	rbw = max(params._rbw, 0.0f);
+	noisefloor = params._noisefloor;
+	maxfftsizelog2 = min(max(msb(params._maxfftsize), MINFFTSIZELOG2), MAXFFTSIZELOG2);
+	progressive = params._progressive;
+	fftengine = params._fourstep ? FftEngineFourStep : FftEngineInPlace;
+
+	// whole periods need no window
+	if (response || coherent) {
+		window = WindowRectangular;
+	}
+}
+
+// The frequency to generate for an analysis of frequency, moved onto the
+// nearest bin in coherent mode
+float Analyzer::GeneratorFrequency(float frequency)
+{
+	if (!coherent) {
+		return frequency;
 	}
+
+	float rate = audio.SampleRateFloat();
+	int sizelog2 = min(COHERENTFFTSIZELOG2, maxfftsizelog2);
+	while (sizelog2 < maxfftsizelog2 && float(1 << sizelog2) < COHERENTPERIODS * rate / frequency) {
+		sizelog2++;
+	}
+	coherentsizelog2 = sizelog2;
+
+	int size = 1 << sizelog2;
+	int bin = max(int(roundf(frequency * float(size) / rate)), 1);
+	return float(bin) * rate / float(size);
+}
+
+int Analyzer::CoherentFftSize() const
+{
+	return coherent ? 1 << coherentsizelog2 : 0;
 }
 
 void Analyzer::Refresh()
 {
 	enoughdata = false;
+	averagedframes = 0;
+	SettleRestart(RingPosition());
+
+	// results measured under the old configuration are no longer valid
+	ClearResults();
+}
+
+// Pairs in one settling block, whole periods of the stimulus
+int Analyzer::SettleBlock(float frequency) const
+{
+	if (response) {
+		return MULTITONELENGTH;
+	}
+
+	float period = audio.SampleRateFloat() / frequency;
+	float periods = ceilf(SETTLEMINBLOCK / period);
+	return max(int(roundf(periods * period)), 1);
+}
+
+void Analyzer::SettleRestart(uint64_t position)
+{
+	settle_start(settlestate);
+	settlescan = position;
+	settlerunstart = position;
+	settleblocks = 0;
+	settled = false;
+	settledposition = position;
+}
+
+// Scan the input that arrived since the last call for the first run of
+// steady blocks on both channels. Input from its start on is settled.
+void Analyzer::Settle(float frequency)
+{
+	dsp::RingExtent extent = inputReader.extent();
+
+	// the writer cleared the ring for new parameters, or overtook the scan
+	if (settlescan < extent.start || !inputReader.valid(settlescan)) {
+		SettleRestart(extent.start);
+	}
+
+	uint64_t blocklen = 2*SettleBlock(frequency);
+	while (!settled && extent.end - settlescan >= blocklen) {
+		InputReader::Spans spans = inputReader.spans(settlescan, int(blocklen));
+		for (int s = 0; s < 2; s++) {
+			settle_run(settlestate, spans.ptr[s], spans.len[s]/2);
+		}
+
+		if (settle_finish(settlestate, SETTLESIGNALTOLERANCE, SETTLEFILTEREDTOLERANCE, SETTLEFLOOR)) {
+			settleblocks++;
+		}
+		else {
+			// a run starts with the block that broke the last one
+			settlerunstart = settlescan;
+			settleblocks = 0;
+		}
+		settlescan += blocklen;
+
+		if (settleblocks >= SETTLEBLOCKS) {
+			settled = true;
+			settledposition = settlerunstart;
+		}
+	}
+
+	// input that never settles is taken after the fixed margin
+	uint64_t timeout = 2*uint64_t(SETTLETIMEOUT * audio.SampleRateFloat() + extralen);
+	if (!settled && extent.end - extent.start >= timeout) {
+		settled = true;
+		settledposition = extent.start + 2*extralen;
+	}
+}
+
+// Number of sample pairs held from the first settled one on
+int Analyzer::SettledLength() const
+{
+	if (!settled) {
+		return 0;
+	}
+
+	dsp::RingExtent extent = inputReader.extent();
+	return int(extent.end - max(settledposition, extent.start)) >> 1;
 }
 
+// Frames of an average are this many pairs apart
+int Analyzer::AverageHop(int size) const
+{
+	return max(int(float(size) * (1.0f - overlap)), 1);
+}
+
+// Settled pairs an analysis at size needs, all the configured frames
+// when averaging
+int Analyzer::AnalysisLength(int size) const
+{
+	if (averagingmode == GeneratorParameters::AveragingModeNone) {
+		return size;
+	}
+
+	return size + (averages - 1) * AverageHop(size);
+}
+
+// Track whether the ring holds enough settled input and pick the FFT
+// size, the input itself is only read once an analysis is started
 bool Analyzer::Update(float frequency)
 {
-	float *fftmem = (float*)(SDRAM_BASE_ADDR + 15*1048576);
+	extralen = max(int(4 * audio.SampleRateFloat() / frequency), 200);
+	Settle(frequency);
+	int datalen = SettledLength();
+
+	if (!resultready) {
+		int factorlog2 = ZoomFactorLog2(frequency);
+		if (response) {
+			fftsizelog2 = MULTITONELENGTHLOG2 + RESPONSEPERIODSLOG2;
+			targetfftsizelog2 = fftsizelog2;
+			fftsize = 1 << fftsizelog2;
+			zoomfactorlog2 = 0;
+			samplerate = audio.SampleRateFloat();
+			enoughdata = datalen >= fftsize;
+		}
+		else if (coherent) {
+			// whole periods at one size, settled
+			fftsizelog2 = coherentsizelog2;
+			targetfftsizelog2 = fftsizelog2;
+			fftsize = 1 << fftsizelog2;
+			zoomfactorlog2 = 0;
+			samplerate = audio.SampleRateFloat();
+			enoughdata = datalen >= AnalysisLength(fftsize);
+		}
+		else if (factorlog2 > 0) {
+			// decimated points from the settled input
+			int points = (datalen >> factorlog2) - ZOOMTAPSPERPHASE;
+			if (points < (1 << ZOOMMINFFTSIZELOG2)) {
+				enoughdata = false;
+			}
+			else {
+				enoughdata = true;
+
+				fftsizelog2 = min(msb(points), ZOOMMAXFFTSIZELOG2);
+				targetfftsizelog2 = fftsizelog2;
+				fftsize = 1 << fftsizelog2;
+				zoomfactorlog2 = factorlog2;
+				samplerate = audio.SampleRateFloat() / float(1 << factorlog2);
+			}
+		}
+		else {
+			targetfftsizelog2 = FftSizeLog2(frequency);
+			fftsizelog2 = targetfftsizelog2;
+
+			// the largest stage the ring holds until it holds the target
+			if (progressive) {
+				int minlog2 = max(MinSizeLog2(frequency), PROGRESSIVEMINFFTSIZELOG2);
+				while (fftsizelog2 - PROGRESSIVESTEPLOG2 >= minlog2 && datalen < AnalysisLength(1 << fftsizelog2)) {
+					fftsizelog2 -= PROGRESSIVESTEPLOG2;
+				}
+			}
+
+			fftsize = 1 << fftsizelog2;
+			zoomfactorlog2 = 0;
+			samplerate = audio.SampleRateFloat();
+			enoughdata = datalen >= AnalysisLength(fftsize);
+		}
+	}
+
+	return !resultready;
+}
+
+// Smallest transform that resolves the harmonics of frequency, up to the cap
+int Analyzer::MinSizeLog2(float frequency) const
+{
+	float periods = MINPERIODS * audio.SampleRateFloat() / frequency;
+	int sizelog2 = MINFFTSIZELOG2;
+	while (sizelog2 < maxfftsizelog2 && float(1 << sizelog2) < periods) {
+		sizelog2++;
+	}
+
+	return sizelog2;
+}
+
+// Smallest transform that resolves the harmonics of frequency and meets
+// the resolution bandwidth and noise floor targets, up to the cap. The
+// noise floor is judged from the noise of the last full spectrum.
+int Analyzer::FftSizeLog2(float frequency) const
+{
+	float rate = audio.SampleRateFloat();
+	int sizelog2 = MinSizeLog2(frequency);
+
+	for (; sizelog2 < maxfftsizelog2; sizelog2++) {
+		float size = float(1 << sizelog2);
+		float bandwidth = window_enbw(window, sizelog2) * rate / size;
+
+		bool narrow = rbw <= 0 || bandwidth <= rbw;
+		bool quiet = !noisedensityvalid || noisedensity + 10*log10f(bandwidth) <= noisefloor;
+		if (narrow && quiet) {
+			break;
+		}
+	}
+
+	return sizelog2;
+}
+
+// Fix the end of the input to analyze at the latest sample
+void Analyzer::Capture()
+{
+	captureposition = RingPosition();
+	cancelled = false;
+}
+
+// Transform the windowed block in FFT memory, false if cancelled
+bool Analyzer::Transform()
+{
+	float *fftmem = (float*)FFTMEM;
 	float *resignal = &fftmem[0*MAXFFTSIZE];
 	float *imsignal = &fftmem[1*MAXFFTSIZE];
 	float *refiltered = &fftmem[2*MAXFFTSIZE];
 	float *imfiltered = &fftmem[3*MAXFFTSIZE];
 
-	int extralen = max(int(4 * audio.SampleRateFloat() / frequency), 200);
-	int datalen = (inputRing.used() >> 1);
-	int mindatalen = min(max(int(11 * audio.SampleRateFloat() / frequency), 1024), MAXFFTSIZE);
+	// both channels are real, transform them together
+	if (fftengine == FftEngineFourStep && fftsize >= FOURSTEPMINSIZE) {
+		if (!fft_fourstep(resignal, refiltered, imsignal, imfiltered, fftsizelog2-1, fftwork, FFTWORKSIZE, &cancelled)) {
+			return false;
+		}
+		fft_real_split(imsignal, imfiltered, resignal, imsignal, refiltered, imfiltered, fftsizelog2-1);
+	}
+	else {
+		fft_real_pair(resignal, imsignal, refiltered, imfiltered, fftsizelog2-1);
+	}
 
-	if (!resultready) {
-		if (datalen < mindatalen + extralen) {
-			enoughdata = false;
+	return !cancelled;
+}
+
+// Absolute position of the end of the input
+uint64_t Analyzer::RingPosition() const
+{
+	return inputReader.extent().end;
+}
+
+// Number of sample pairs written after position
+int Analyzer::SamplesSince(uint64_t position) const
+{
+	uint64_t delta = RingPosition() - position;
+	if (delta > INPUTRINGLEN) {
+		delta = INPUTRINGLEN;
+	}
+
+	return int(delta) >> 1;
+}
+
+// Transform overlapped frames from the input ring and fold their power
+// spectra into the accumulators. Linear averaging starts over on every
+// analysis, exponential and peak hold carry on from the previous one
+// with the frames that arrived in between.
+bool Analyzer::Average()
+{
+	float *fftmem = (float*)FFTMEM;
+	float *resignal = &fftmem[0*MAXFFTSIZE];
+	float *refiltered = &fftmem[2*MAXFFTSIZE];
+
+	int hop = AverageHop(fftsize);
+
+	// frames that fit in the settled part of the input
+	int datalen = SettledLength() - fftsize;
+	int available = 1 + max(datalen, 0) / hop;
+
+	if (averagingmode == GeneratorParameters::AveragingModeLinear || averagefftsize != fftsize) {
+		averagedframes = 0;
+	}
+
+	uint64_t position = captureposition;
+	int frames;
+	if (averagedframes == 0) {
+		frames = min(averages, available);
+	}
+	else {
+		frames = min(min(SamplesSince(averageposition) / hop, averages), available);
+		frames = max(frames, 1);
+	}
+
+	// oldest frame first, relative to the input at the start
+	int accumulated = 0;
+	for (int frame = frames - 1; frame >= 0; frame--) {
+		if (cancelled) {
+			return false;
 		}
-		else {
-			enoughdata = true;
 
-			fftsizelog2 = msb(datalen);
-			if (fftsizelog2 > MAXFFTSIZELOG2) {
-				fftsizelog2 = MAXFFTSIZELOG2;
+		int delay = frame * hop + SamplesSince(position);
+		if (!SplitInput(resignal, refiltered, signalmean, filteredmean, fftsize, delay)) {
+			continue;
+		}
+		if (!Transform()) {
+			return false;
+		}
+		Accumulate();
+		accumulated++;
+	}
+
+	if (cancelled) {
+		return false;
+	}
+
+	// the writer overtook every frame, take the latest block instead
+	if (accumulated == 0) {
+		SplitInput(resignal, refiltered, signalmean, filteredmean, fftsize);
+		if (!Transform()) {
+			return false;
+		}
+		Accumulate();
+	}
+
+	averagefftsize = fftsize;
+	averageposition = position;
+
+	LoadAverage();
+	return true;
+}
+
+void Analyzer::Accumulate()
+{
+	float *fftmem = (float*)FFTMEM;
+	float *resignal = &fftmem[0*MAXFFTSIZE];
+	float *imsignal = &fftmem[1*MAXFFTSIZE];
+	float *refiltered = &fftmem[2*MAXFFTSIZE];
+	float *imfiltered = &fftmem[3*MAXFFTSIZE];
+
+	float *avgsignal = (float*)AVERAGEMEM;
+	float *avgfiltered = &avgsignal[MAXFFTSIZE/2+1];
+
+	int bins = fftsize/2 + 1;
+
+	if (averagedframes == 0) {
+		for (int i = 0; i < bins; i++) {
+			avgsignal[i] = resignal[i]*resignal[i] + imsignal[i]*imsignal[i];
+			avgfiltered[i] = refiltered[i]*refiltered[i] + imfiltered[i]*imfiltered[i];
+		}
+	}
+	else if (averagingmode == GeneratorParameters::AveragingModeExponential) {
+		float alpha = 1.0f / float(averages);
+		for (int i = 0; i < bins; i++) {
+			float ps = resignal[i]*resignal[i] + imsignal[i]*imsignal[i];
+			float pf = refiltered[i]*refiltered[i] + imfiltered[i]*imfiltered[i];
+			avgsignal[i] += alpha * (ps - avgsignal[i]);
+			avgfiltered[i] += alpha * (pf - avgfiltered[i]);
+		}
+	}
+	else if (averagingmode == GeneratorParameters::AveragingModePeakHold) {
+		for (int i = 0; i < bins; i++) {
+			float ps = resignal[i]*resignal[i] + imsignal[i]*imsignal[i];
+			float pf = refiltered[i]*refiltered[i] + imfiltered[i]*imfiltered[i];
+			avgsignal[i] = max(avgsignal[i], ps);
+			avgfiltered[i] = max(avgfiltered[i], pf);
+		}
+	}
+	else {
+		for (int i = 0; i < bins; i++) {
+			avgsignal[i] += resignal[i]*resignal[i] + imsignal[i]*imsignal[i];
+			avgfiltered[i] += refiltered[i]*refiltered[i] + imfiltered[i]*imfiltered[i];
+		}
+	}
+
+	averagedframes++;
+}
+
+// Replace the spectrum of the last frame with the averaged magnitudes
+void Analyzer::LoadAverage()
+{
+	float *fftmem = (float*)FFTMEM;
+	float *resignal = &fftmem[0*MAXFFTSIZE];
+	float *imsignal = &fftmem[1*MAXFFTSIZE];
+	float *refiltered = &fftmem[2*MAXFFTSIZE];
+	float *imfiltered = &fftmem[3*MAXFFTSIZE];
+
+	float *avgsignal = (float*)AVERAGEMEM;
+	float *avgfiltered = &avgsignal[MAXFFTSIZE/2+1];
+
+	float scale = 1.0f;
+	if (averagingmode == GeneratorParameters::AveragingModeLinear) {
+		scale = 1.0f / float(max(averagedframes, 1));
+	}
+
+	int bins = fftsize/2 + 1;
+	for (int i = 0; i < bins; i++) {
+		resignal[i] = sqrtf(avgsignal[i] * scale);
+		imsignal[i] = 0;
+		refiltered[i] = sqrtf(avgfiltered[i] * scale);
+		imfiltered[i] = 0;
+	}
+}
+
+// Nearest bin to the given harmonic of the frequency
+int Analyzer::HarmonicCenter(float frequency, int harmonic)
+{
+	return int(roundf(float(harmonic) * frequency * (float(fftsize) / samplerate)));
+}
+
+// Collect the bins around each harmonic in [startbin, endbin), and the
+// neighbours of the peaks searched at either end
+int Analyzer::HarmonicBins(float frequency, int startbin, int endbin)
+{
+	startbin = max(startbin - 1, 1);
+	endbin = min(endbin + 1, fftsize/2);
+
+	int numbins = 0;
+	int lastbin = 0;
+
+	for (int harmonic = 2; harmonic <= 34; harmonic++) {
+		int center = HarmonicCenter(frequency, harmonic);
+		if (center - HARMONICBANKSPAN >= endbin) {
+			break;
+		}
+
+		for (int bin = center - HARMONICBANKSPAN; bin <= center + HARMONICBANKSPAN; bin++) {
+			if (bin < startbin || bin >= endbin || bin <= lastbin) {
+				continue;
+			}
+			if (numbins == HARMONICBANKMAXBINS) {
+				// too many for the bank to pay off
+				return 0;
 			}
 
-			fftsize = 1 << fftsizelog2;
+			harmonicbins[numbins++] = bin;
+			lastbin = bin;
+		}
+	}
 
-			SplitInput(resignal, refiltered, signalmean, filteredmean, fftsize);
+	return numbins;
+}
+
+bool Analyzer::HarmonicBankCheaper(int numbins) const
+{
+	int fftcost = fftsizelog2 * FFTCYCLES + FFTOVERHEADCYCLES;
+	int bankcost = numbins * GOERTZELCYCLES;
+
+	return bankcost < fftcost;
+}
+
+// Evaluate the fundamental and harmonic bins directly, and leave
+// spectra with only those bins in FFT memory
+void Analyzer::HarmonicBank(float frequency, int numbins)
+{
+	float *fftmem = (float*)FFTMEM;
+	float *resignal = &fftmem[0*MAXFFTSIZE];
+	float *imsignal = &fftmem[1*MAXFFTSIZE];
+	float *refiltered = &fftmem[2*MAXFFTSIZE];
+	float *imfiltered = &fftmem[3*MAXFFTSIZE];
+
+	int fundamentalbins[2*HARMONICBANKSPAN+1];
+	float fundamentalpower[2*HARMONICBANKSPAN+1];
+	int numfundamental = 0;
+
+	int center = HarmonicCenter(frequency, 1);
+	for (int bin = center - HARMONICBANKSPAN; bin <= center + HARMONICBANKSPAN; bin++) {
+		if (bin >= 1 && bin < fftsize/2) {
+			fundamentalbins[numfundamental++] = bin;
 		}
 	}
 
-	return !resultready;
+	goertzel_bank(resignal, fftsize, fundamentalbins, numfundamental, fundamentalpower);
+	goertzel_bank(refiltered, fftsize, harmonicbins, numbins, harmonicpower);
+
+	memset(resignal, 0, fftsize*sizeof(float));
+	memset(imsignal, 0, fftsize*sizeof(float));
+	memset(refiltered, 0, fftsize*sizeof(float));
+	memset(imfiltered, 0, fftsize*sizeof(float));
+
+	for (int i = 0; i < numfundamental; i++) {
+		resignal[fundamentalbins[i]] = sqrtf(fundamentalpower[i]);
+	}
+	for (int i = 0; i < numbins; i++) {
+		refiltered[harmonicbins[i]] = sqrtf(harmonicpower[i]);
+	}
+}
+
+// Strongest bin within the search width around center
+int Analyzer::PeakBin(const float *re, const float *im, int center, int endbin)
+{
+	int start = max(center - HARMONICBANKWIDTH, 1);
+	int end = min(center + HARMONICBANKWIDTH, endbin - 1);
+
+	int peak = max(min(center, end), 1);
+	float peakpower = 0;
+	for (int i = start; i <= end; i++) {
+		float p = binpower(re, im, i);
+		if (p > peakpower) {
+			peakpower = p;
+			peak = i;
+		}
+	}
+
+	return peak;
+}
+
+// Frequency and unscaled amplitude of the tone peaking at bin, between
+// bins and corrected for the window
+float Analyzer::PeakFrequency(const float *re, const float *im, int bin, float& amplitude)
+{
+	float center = sqrtf(binpower(re, im, bin));
+	if (bin < 1 || bin + 1 >= fftsize/2) {
+		amplitude = center;
+		return fftbinfrequency(bin, fftsize);
+	}
+
+	float left = sqrtf(binpower(re, im, bin - 1));
+	float right = sqrtf(binpower(re, im, bin + 1));
+	float offset = window_interpolate(window, left, center, right, amplitude);
+
+	return (float(bin) + offset) * (samplerate / fftsize);
+}
+
+// Fundamental from the signal channel, harmonics and noise from the
+// filtered channel, up to endbin. Noise figures need a full spectrum.
+void Analyzer::Measure(float frequency, int endbin, bool fullspectrum)
+{
+	float *fftmem = (float*)FFTMEM;
+	float *resignal = &fftmem[0*MAXFFTSIZE];
+	float *imsignal = &fftmem[1*MAXFFTSIZE];
+	float *refiltered = &fftmem[2*MAXFFTSIZE];
+	float *imfiltered = &fftmem[3*MAXFFTSIZE];
+
+	float scaling_0dBu = fftscaling(fftsize);
+	endbin = min(endbin, fftsize/2);
+
+	AnalysisResult result;
+	result._flags = AnalysisResult::FlagValid;
+	result._fftsize = fftsize;
+	result._rbw = window_enbw(window, fftsizelog2) * samplerate / fftsize;
+	result._targetfftsize = 1 << targetfftsizelog2;
+	if (fftsizelog2 >= targetfftsizelog2) {
+		result._flags |= AnalysisResult::FlagFinal;
+	}
+
+	int fundamentalbin = PeakBin(resignal, imsignal, HarmonicCenter(frequency, 1), fftsize/2);
+	float fundamental;
+	result._fundamentalfrequency = PeakFrequency(resignal, imsignal, fundamentalbin, fundamental);
+	fundamental *= scaling_0dBu;
+	result._fundamentallevel = fftabsvaluedb(fundamental);
+
+	// levels are interpolated between bins for any window
+	float harmonicsum = 0;
+	int numharmonics = 0;
+	while (numharmonics < ANALYSISMAXHARMONICS) {
+		int center = HarmonicCenter(frequency, numharmonics + 2);
+		if (center >= endbin) {
+			break;
+		}
+
+		int bin = PeakBin(refiltered, imfiltered, center, endbin);
+		float a;
+		PeakFrequency(refiltered, imfiltered, bin, a);
+		a *= scaling_0dBu;
+		harmonicsum += a * a;
+
+		result._harmoniclevel[numharmonics] = fftabsvaluedb(a);
+		result._harmonicbin[numharmonics] = bin;
+		numharmonics++;
+	}
+	result._numharmonics = numharmonics;
+
+	float reference = fundamental > 0 ? fundamental : 1;
+	result._thd = fftabsvaluedb(sqrtf(harmonicsum) / reference);
+
+	result._thdn = 0;
+	result._noiselevel = 0;
+	result._sinad = 0;
+
+	if (fullspectrum) {
+		// residual and harmonic power, leaving out DC and the fundamental lobe
+		int lobewidth = window_lobewidth(window);
+		float enbw = window_enbw(window, fftsizelog2);
+		float residual = 0;
+		float harmonics = 0;
+		int noisebins = 0;
+		int harmonic = 2;
+		for (int i = lobewidth; i < endbin; i++) {
+			if (abs(i - fundamentalbin) <= lobewidth) {
+				continue;
+			}
+
+			float p = binpower(refiltered, imfiltered, i);
+			residual += p;
+
+			int center = HarmonicCenter(frequency, harmonic);
+			while (i > center + lobewidth) {
+				center = HarmonicCenter(frequency, ++harmonic);
+			}
+			if (i >= center - lobewidth) {
+				harmonics += p;
+			}
+			else {
+				noisebins++;
+			}
+		}
+
+		// power sums are corrected by the window noise bandwidth
+		float thdn = sqrtf(residual / enbw) * scaling_0dBu;
+		float noise = sqrtf(max(residual - harmonics, 0.0f) / enbw) * scaling_0dBu;
+
+		result._flags |= AnalysisResult::FlagNoise;
+		result._thdn = fftabsvaluedb(thdn / reference);
+		result._noiselevel = fftabsvaluedb(noise);
+		result._sinad = -result._thdn;
+
+		// spread over the bins it came from, for sizing the next transform
+		if (noise > 0 && noisebins > 0) {
+			noisedensity = result._noiselevel - 10*log10f(noisebins * samplerate / fftsize);
+			noisedensityvalid = true;
+		}
+	}
+
+	analysisResult.Store(result);
+}
+
+// Decimation for zoom analysis of a fundamental, 0 for none
+int Analyzer::ZoomFactorLog2(float frequency) const
+{
+	if (!zoom || coherent || frequency > ZOOMMAXFREQUENCY || averagingmode != GeneratorParameters::AveragingModeNone) {
+		return 0;
+	}
+
+	// lowest decimated rate that keeps the harmonics in the passband
+	float minrate = ZOOMHARMONICS * frequency / ZOOMPASSBAND;
+	int factorlog2 = msb(int(audio.SampleRateFloat() / minrate));
+
+	return min(max(factorlog2, 0), ZOOMMAXFACTORLOG2);
+}
+
+// Mix the block ending delay pairs before the latest input down by a
+// quarter of the decimated rate, decimate and transform it. This leaves
+// the band from DC to half the decimated rate in FFT memory, as a real
+// transform of fftsize points at that rate would. False if the block was
+// overwritten or the analysis cancelled.
+bool Analyzer::Zoom(int delay)
+{
+	float *fftmem = (float*)FFTMEM;
+	float *resignal = &fftmem[0*MAXFFTSIZE];
+	float *imsignal = &fftmem[1*MAXFFTSIZE];
+	float *refiltered = &fftmem[2*MAXFFTSIZE];
+	float *imfiltered = &fftmem[3*MAXFFTSIZE];
+
+	int inputs = (fftsize + ZOOMTAPSPERPHASE - 1) << zoomfactorlog2;
+
+	dsp::RingExtent extent = inputReader.extent();
+	int length = 2*(inputs + delay);
+	InputReader::Spans spans = inputReader.delayspans(extent, length, 2*inputs);
+
+	int held = int(extent.end - extent.start);
+	uint64_t first = extent.end - min(length, held);
+	uint64_t last = first + spans.len[0] + spans.len[1];
+
+	int64_t signalsum;
+	int64_t filteredsum;
+	InputSums(first, last, signalsum, filteredsum);
+	int count = max(int(last - first) / 2, 1);
+	signalmean = float(signalsum / count);
+	filteredmean = float(filteredsum / count);
+
+	ZoomState state;
+	zoom_start(state, zoomfactorlog2, 0.25 / double(1 << zoomfactorlog2), signalmean, filteredmean);
+
+	// zeros before the oldest input, then the input
+	const int32_t *segments[3] = { 0, spans.ptr[0], spans.ptr[1] };
+	int lengths[3] = { spans.zeros/2, spans.len[0]/2, spans.len[1]/2 };
+	for (int s = 0; s < 3; s++) {
+		const int32_t *p = segments[s];
+		for (int pairs = lengths[s]; pairs > 0; ) {
+			if (cancelled) {
+				return false;
+			}
+
+			int run = min(pairs, CANCELCHUNK);
+			zoom_run(state, p, run, resignal, imsignal, refiltered, imfiltered);
+			if (p) {
+				p += 2*run;
+			}
+			pairs -= run;
+		}
+	}
+
+	const float *fftwindow = window_table(window, fftsizelog2);
+	window_apply(resignal, fftwindow, fftsize);
+	window_apply(imsignal, fftwindow, fftsize);
+	window_apply(refiltered, fftwindow, fftsize);
+	window_apply(imfiltered, fftwindow, fftsize);
+
+	fft(resignal, imsignal, fftsizelog2-1);
+	fft(refiltered, imfiltered, fftsizelog2-1);
+	zoom_unshift(resignal, imsignal, fftsize);
+	zoom_unshift(refiltered, imfiltered, fftsize);
+
+	return !cancelled && inputReader.valid(first) && InputSumsValid(first);
+}
+
+// Gain and phase of each multitone stimulus tone from whole periods
+// ending at the capture
+bool Analyzer::Response()
+{
+	float *fftmem = (float*)FFTMEM;
+	float *resignal = &fftmem[0*MAXFFTSIZE];
+	float *imsignal = &fftmem[1*MAXFFTSIZE];
+	float *refiltered = &fftmem[2*MAXFFTSIZE];
+
+	if (!SplitInput(resignal, refiltered, signalmean, filteredmean, fftsize, SamplesSince(captureposition))) {
+		SplitInput(resignal, refiltered, signalmean, filteredmean, fftsize);
+	}
+	int offset = process.LoopOffset(splitposition);
+
+	if (cancelled || !Transform()) {
+		return false;
+	}
+
+	float scaling_0dBu = fftscaling(fftsize);
+	float reference = level + fftabsvaluedb(multitone_amplitude());
+
+	ResponseResult result;
+	result._flags = ResponseResult::FlagValid;
+	result._fftsize = fftsize;
+	result._numtones = min(MULTITONETONES, RESPONSEMAXTONES);
+
+	for (int k = 0; k < result._numtones; k++) {
+		int tonebin = multitone_bin(k);
+		int bin = tonebin << RESPONSEPERIODSLOG2;
+		float a = sqrtf(binpower(resignal, imsignal, bin)) * scaling_0dBu;
+
+		// a sine starting at phase p shows up at p - pi/2
+		int cycles = (tonebin * offset) & (MULTITONELENGTH-1);
+		float generated = multitone_phase(k) + 2*M_PI * float(cycles) / float(MULTITONELENGTH) - 0.5f*M_PI;
+		float phase = atan2f(imsignal[bin], resignal[bin]) - generated;
+		phase -= 2*M_PI * floorf(phase / (2*M_PI) + 0.5f);
+
+		result._frequency[k] = fftbinfrequency(bin, fftsize);
+		result._gain[k] = fftabsvaluedb(a) - reference;
+		result._phase[k] = phase * (180.0f / M_PI);
+	}
+
+	responseResult.Store(result);
+	return true;
 }
 
 bool Analyzer::CanProcess() const
@@ -166,14 +1021,28 @@ bool Analyzer::CanProcess() const
 	return enoughdata;
 }
 
-void Analyzer::Process(float frequency, bool mode)
+// Analyze the input ending at the capture. Returns false if cancelled
+// between stages, with the shared results left as they were.
+bool Analyzer::Process(float frequency, bool mode)
 {
-	float *fftmem = (float*)(SDRAM_BASE_ADDR + 15*1048576);
+	float *fftmem = (float*)FFTMEM;
 	float *resignal = &fftmem[0*MAXFFTSIZE];
 	float *imsignal = &fftmem[1*MAXFFTSIZE];
 	float *refiltered = &fftmem[2*MAXFFTSIZE];
 	float *imfiltered = &fftmem[3*MAXFFTSIZE];
 
+	if (cancelled) {
+		return false;
+	}
+
+	if (response) {
+		if (!Response()) {
+			return false;
+		}
+		resultready = true;
+		return true;
+	}
+
 	bool include_first_harmonic = false;
 	float *re;
 	float *im;
@@ -189,19 +1058,10 @@ void Analyzer::Process(float frequency, bool mode)
 		include_first_harmonic = false;
 	}
 
-	float *fftwindow = (float*)(SDRAM_BASE_ADDR + 14*1048576 + fftsize*4);
-	for (int i = 0; i < fftsize; i++) {
-		float w = fftwindow[i];
-		resignal[i] = (resignal[i] - signalmean) * w;
-		refiltered[i] = (refiltered[i] - filteredmean) * w;
-	}
-
-	memset(imsignal, 0, fftsize*sizeof(float));
-	memset(imfiltered, 0, fftsize*sizeof(float));
-	fft(re, im, fftsizelog2-1);
-
 	int startbin = frequencyfftbin(frequency, fftsize);
-	int endbin = min(frequencyfftbin(frequency * 34, fftsize), frequencyfftbin(audio.SampleRateFloat() - 3000.0, fftsize));
+	// zoomed, only the decimation filter passband is good
+	float topfrequency = zoomfactorlog2 > 0 ? ZOOMPASSBAND * samplerate : samplerate - 3000.0f;
+	int endbin = min(frequencyfftbin(frequency * 34, fftsize), frequencyfftbin(topfrequency, fftsize));
 
 	if (include_first_harmonic) {
 		startbin -= 10;
@@ -209,14 +1069,63 @@ void Analyzer::Process(float frequency, bool mode)
 		startbin += 10;
 	}
 
+	// distortion only: look at the harmonics alone if that is cheaper
+	int numbins = 0;
+	if (zoomfactorlog2 == 0 && !include_first_harmonic && averagingmode == GeneratorParameters::AveragingModeNone) {
+		numbins = HarmonicBins(frequency, startbin, endbin);
+	}
+
+	bool harmonicbank = numbins > 0 && HarmonicBankCheaper(numbins + 2*HARMONICBANKSPAN + 1);
+
+	// the block ending at the capture, or the latest one if that is gone
+	if (zoomfactorlog2 > 0) {
+		if (!Zoom(SamplesSince(captureposition)) && !cancelled) {
+			Zoom(0);
+		}
+		if (cancelled) {
+			return false;
+		}
+	}
+	else if (harmonicbank || averagingmode == GeneratorParameters::AveragingModeNone) {
+		if (!SplitInput(resignal, refiltered, signalmean, filteredmean, fftsize, SamplesSince(captureposition))) {
+			SplitInput(resignal, refiltered, signalmean, filteredmean, fftsize);
+		}
+
+		if (cancelled) {
+			return false;
+		}
+		if (harmonicbank) {
+			HarmonicBank(frequency, numbins);
+		}
+		else if (!Transform()) {
+			return false;
+		}
+	}
+	else if (!Average()) {
+		return false;
+	}
+
+	if (cancelled) {
+		return false;
+	}
+	Measure(frequency, endbin, !harmonicbank);
+
 	float filteredmaxvalue;
 	int filteredmaxbin;
 	fftabs(re, im, startbin, endbin, filteredmaxvalue, filteredmaxbin, fftsize);
 
-	*distortionFrequency = fftbinfrequency(filteredmaxbin, fftsize);
+	// fftabs left magnitudes in re, interpolate where both neighbours have one
+	float distortionfrequency = fftbinfrequency(filteredmaxbin, fftsize);
+	if (filteredmaxbin > max(startbin, 1) && filteredmaxbin + 1 < min(endbin, fftsize/2)) {
+		float offset = window_interpolate(window, re[filteredmaxbin - 1], re[filteredmaxbin], re[filteredmaxbin + 1], filteredmaxvalue);
+		distortionfrequency = (float(filteredmaxbin) + offset) * (samplerate / fftsize);
+	}
+
+	*distortionFrequency = distortionfrequency;
 	*distortionLevel = fftabsvaluedb(filteredmaxvalue);
 
 	resultready = true;
+	return true;
 }
 
 void Analyzer::Finish()
@@ -3,12 +3,93 @@
 
 #include <math.h>
 #include "audio.h"
+#include "../emc_setup.h"
+#include "../common/sharedtypes.h"
+#include "../lib/window.h"
+#include "../lib/settle.h"
+
+#define MAXFFTSIZELOG2 16
+#define MAXFFTSIZE (1 << MAXFFTSIZELOG2)
+// Smallest FFT, and the fewest periods of the fundamental in one
+#define MINFFTSIZELOG2 10
+#define MINPERIODS 11
+
+// Progressive analysis: the first stage, and the size ratio of stages
+#define PROGRESSIVEMINFFTSIZELOG2 11
+#define PROGRESSIVESTEPLOG2 2
+
+// SDRAM above the input ring
+#define ANALYZERWORKMEM (SDRAM_BASE_ADDR + 13*1048576)
+#define AVERAGEMEM ANALYZERWORKMEM
+// OSCLOOPMEM of oscillator.h at 320 kB
+#define ZOOMFILTERMEM (SDRAM_BASE_ADDR + 13*1048576 + 384*1024)
+#define ZOOMFILTERSIZE (128*1024)
+#define FFTWINDOWMEM (SDRAM_BASE_ADDR + 14*1048576)
+#define FFTWINDOWSIZE (512*1024)
+#define FFTTABLEMEM (SDRAM_BASE_ADDR + 14*1048576 + 512*1024)
+#define FFTTABLESIZE (512*1024)
+#define FFTMEM (SDRAM_BASE_ADDR + 15*1048576)
+
+// Input pairs read between checks for a cancelled analysis
+#define CANCELCHUNK 4096
+
+// Tile buffer for the four-step FFT in the M4 local SRAM, in floats
+#define FFTWORKSIZE 4096
+// Four-step FFT is used from this size up
+#define FOURSTEPMINSIZE 16384
+
+extern float fftwork[FFTWORKSIZE];
+
+// Harmonic bank: bins searched for the peak on each side of a harmonic,
+// bins evaluated, one more so the peak has both neighbours to interpolate,
+// and the most bins before the FFT is always cheaper
+#define HARMONICBANKWIDTH 2
+#define HARMONICBANKSPAN (HARMONICBANKWIDTH + 1)
+#define HARMONICBANKMAXBINS 64
+
+// Zoom analysis: fundamentals up to ZOOMMAXFREQUENCY are mixed down and
+// decimated as far as the first ZOOMHARMONICS harmonics stay within the
+// ZOOMPASSBAND fraction of the decimated rate
+#define ZOOMMAXFREQUENCY 50.0f
+#define ZOOMHARMONICS 10
+#define ZOOMPASSBAND 0.4f
+#define ZOOMMINFFTSIZELOG2 10
+#define ZOOMMAXFFTSIZELOG2 14
+
+// Coherent analysis: FFT size, raised to hold at least COHERENTPERIODS
+// periods of the fundamental
+#define COHERENTFFTSIZELOG2 14
+#define COHERENTPERIODS 8
+
+// Frequency response: stimulus periods in one transform
+#define RESPONSEPERIODSLOG2 2
+
+// Settling: input is analyzed from the first of SETTLEBLOCKS + 1 blocks
+// in a row whose rms stays within the tolerances, or after the fixed
+// margin if none turn up in SETTLETIMEOUT seconds. Blocks are whole
+// periods of the stimulus and at least SETTLEMINBLOCK pairs, the floor
+// is the rms change allowed at any level, about -100 dBFS.
+#define SETTLEMINBLOCK 512
+#define SETTLEBLOCKS 3
+#define SETTLESIGNALTOLERANCE 0.002f
+#define SETTLEFILTEREDTOLERANCE 0.1f
+#define SETTLEFLOOR 20000.0f
+#define SETTLETIMEOUT 1.0f
 
 class Analyzer
 {
 public:
+	enum FftEngine
+	{
+		FftEngineInPlace,
+		FftEngineFourStep
+	};
+
 	void Init() {
 		initwindow();
+		initfft();
+		initzoom();
+		initresults();
 	    fftsize = 4096;
 	    fftsizelog2 = 12;
 		signalmean = 0.0;
@@ -16,16 +97,49 @@ public:
 
 		enoughdata = false;
 		resultready = false;
+		cancelled = false;
+
+		fftengine = FftEngineFourStep;
+
+		averagingmode = GeneratorParameters::AveragingModeNone;
+		averages = 1;
+		overlap = 0.5;
+		window = WindowFlatTop;
+		zoom = false;
+		response = false;
+		level = 0.0;
+		coherent = false;
+		coherentsizelog2 = COHERENTFFTSIZELOG2;
+		rbw = 0.0;
+		noisefloor = -130.0;
+		maxfftsizelog2 = MAXFFTSIZELOG2;
+		progressive = false;
+		targetfftsizelog2 = fftsizelog2;
+		noisedensity = 0.0;
+		noisedensityvalid = false;
+		zoomfactorlog2 = 0;
+		samplerate = audio.SampleRateFloat();
+		averagedframes = 0;
+		averagefftsize = 0;
+		averageposition = 0;
+		captureposition = 0;
+		splitposition = 0;
+		extralen = 0;
+		SettleRestart(0);
 	}
 
+	void Configure(const GeneratorParameters& params);
+	float GeneratorFrequency(float frequency);
+	int CoherentFftSize() const;
+
 	int frequencyfftbin(float frequency, int fftsize)
 	{
-		return roundf(frequency) * (fftsize / audio.SampleRateFloat());
+		return roundf(frequency) * (fftsize / samplerate);
 	}
 
 	float fftbinfrequency(int index, int fftsize)
 	{
-		return float(index) * (audio.SampleRateFloat() / fftsize);
+		return float(index) * (samplerate / fftsize);
 	}
 
 	float fftabsvaluedb(float value)
@@ -36,16 +150,49 @@ public:
 
 	void Refresh();
 	bool Update(float frequency);
+	void Capture();
 
 	bool CanProcess() const;
-	void Process(float frequency, bool mode);
+	bool Process(float frequency, bool mode);
+
+	// Stop the running analysis at the next check, from another task
+	void Cancel() { cancelled = true; }
+	void ClearResults();
 
 	void Finish();
 
 private:
-	void SplitInput(float *resignal, float *refiltered, float& signalmean, float& filteredmean, int fftsize);
+	bool SplitInput(float *resignal, float *refiltered, float& signalmean, float& filteredmean, int fftsize, int delay = 0);
+	bool Transform();
+	bool Average();
+	void Accumulate();
+	void LoadAverage();
+	uint64_t RingPosition() const;
+	int SamplesSince(uint64_t position) const;
+	float fftscaling(int fftsize) const;
 	void fftabs(float *re, float *im, int start, int end, float& maxvalue, int& maxindex, int fftsize);
+	int HarmonicCenter(float frequency, int harmonic);
+	int HarmonicBins(float frequency, int startbin, int endbin);
+	bool HarmonicBankCheaper(int numbins) const;
+	void HarmonicBank(float frequency, int numbins);
+	int PeakBin(const float *re, const float *im, int center, int endbin);
+	float PeakFrequency(const float *re, const float *im, int bin, float& amplitude);
+	void Measure(float frequency, int endbin, bool fullspectrum);
+	int ZoomFactorLog2(float frequency) const;
+	int SettleBlock(float frequency) const;
+	void SettleRestart(uint64_t position);
+	void Settle(float frequency);
+	int SettledLength() const;
+	int AverageHop(int size) const;
+	int AnalysisLength(int size) const;
+	int MinSizeLog2(float frequency) const;
+	int FftSizeLog2(float frequency) const;
+	bool Zoom(int delay);
+	bool Response();
 	void initwindow();
+	void initfft();
+	void initzoom();
+	void initresults();
 
 
     int fftsize;
@@ -55,6 +202,50 @@ private:
 
 	bool enoughdata;
 	bool resultready;
+	volatile bool cancelled;
+
+	FftEngine fftengine;
+
+	GeneratorParameters::AveragingMode averagingmode;
+	int averages;
+	float overlap;
+	WindowKind window;
+	bool zoom;
+	// multitone stimulus at the generator level
+	bool response;
+	float level;
+	// generator on a bin of a 2^coherentsizelog2 point FFT
+	bool coherent;
+	int coherentsizelog2;
+	// FFT size policy, and the noise in dBu per Hz found last
+	float rbw;
+	float noisefloor;
+	int maxfftsizelog2;
+	// coarser stages first, working up to the target size
+	bool progressive;
+	int targetfftsizelog2;
+	float noisedensity;
+	bool noisedensityvalid;
+	// decimation of the analyzed input, and its rate
+	int zoomfactorlog2;
+	float samplerate;
+	int averagedframes;
+	int averagefftsize;
+	uint64_t averageposition;
+	uint64_t captureposition;
+	// first input read by the last SplitInput
+	uint64_t splitposition;
+	int extralen;
+	// input scanned for settling so far, and the first settled input
+	SettleState settlestate;
+	uint64_t settlescan;
+	uint64_t settlerunstart;
+	int settleblocks;
+	bool settled;
+	uint64_t settledposition;
+
+	int harmonicbins[HARMONICBANKMAXBINS];
+	float harmonicpower[HARMONICBANKMAXBINS];
 };
 
 
@@ -7,10 +7,104 @@ extern "C" {
 #include "lpc43xx_i2s.h"
 }
 
+#include <string.h>
+
 #include "audio.h"
 
 Audio audio;
 
+namespace {
+
+	// GPDMA channel registers, UM10503 chapter 19
+	struct DmaChannel
+	{
+		volatile uint32_t SRCADDR;
+		volatile uint32_t DESTADDR;
+		volatile uint32_t LLI;
+		volatile uint32_t CONTROL;
+		volatile uint32_t CONFIG;
+		uint32_t RESERVED[3];
+	};
+
+	inline DmaChannel* dmachannel(int channel)
+	{
+		return reinterpret_cast<DmaChannel*>(LPC_GPDMA_BASE + 0x100 + channel * 0x20);
+	}
+
+	// linked list item, word aligned
+	struct DmaLli
+	{
+		uint32_t src;
+		uint32_t dst;
+		uint32_t lli;
+		uint32_t control;
+	};
+
+	// lower channel number has priority
+	const int RX0CHANNEL = 0;
+	const int RX1CHANNEL = 1;
+	const int TX0CHANNEL = 2;
+
+	// DMA request lines, selected in CREG DMAMUX
+	const int I2S0RXPERIPHERAL = 9;		// I2S0 DMA request 1
+	const int I2S0TXPERIPHERAL = 10;	// I2S0 DMA request 2
+	const int I2S1RXPERIPHERAL = 3;		// I2S1 DMA request 1
+
+	// burst of 4 words on a FIFO level of 4
+	const int I2SDMADEPTH = 4;
+
+	const uint32_t DMA_CONTROL_SBSIZE_4 = 1 << 12;
+	const uint32_t DMA_CONTROL_DBSIZE_4 = 1 << 15;
+	const uint32_t DMA_CONTROL_SWIDTH_32 = 2 << 18;
+	const uint32_t DMA_CONTROL_DWIDTH_32 = 2 << 21;
+	const uint32_t DMA_CONTROL_S_MASTER1 = 1 << 24;
+	const uint32_t DMA_CONTROL_D_MASTER1 = 1 << 25;
+	const uint32_t DMA_CONTROL_SI = 1 << 26;
+	const uint32_t DMA_CONTROL_DI = 1 << 27;
+	const uint32_t DMA_CONTROL_I = 1u << 31;
+
+	const uint32_t DMA_CONFIG_E = 1 << 0;
+	const uint32_t DMA_CONFIG_M2P = 1 << 11;
+	const uint32_t DMA_CONFIG_P2M = 2 << 11;
+	const uint32_t DMA_CONFIG_IE = 1 << 14;
+	const uint32_t DMA_CONFIG_ITC = 1 << 15;
+
+	// ping-pong buffers, block k is in buffer k & 1
+	int32_t rx0buffer[2][AUDIOBLOCKWORDS];
+	int32_t rx1buffer[2][AUDIOBLOCKWORDS];
+	int32_t txbuffer[2][AUDIOBLOCKWORDS];
+
+	DmaLli rx0lli[2];
+	DmaLli rx1lli[2];
+	DmaLli txlli[2];
+
+	uint32_t rx0blocks = 0;
+	uint32_t rx1blocks = 0;
+	uint32_t processedblocks = 0;
+
+	// Loop the channel over both buffers forever
+	void dmapingpong(int channel, DmaLli *lli, uint32_t src0, uint32_t src1, uint32_t dst0, uint32_t dst1, uint32_t control, uint32_t config)
+	{
+		lli[0].src = src1;
+		lli[0].dst = dst1;
+		lli[0].lli = uint32_t(&lli[1]);
+		lli[0].control = control;
+
+		lli[1].src = src0;
+		lli[1].dst = dst0;
+		lli[1].lli = uint32_t(&lli[0]);
+		lli[1].control = control;
+
+		DmaChannel *ch = dmachannel(channel);
+		ch->SRCADDR = src0;
+		ch->DESTADDR = dst0;
+		ch->LLI = uint32_t(&lli[0]);
+		ch->CONTROL = control;
+		ch->CONFIG = config;
+	}
+
+}
+
 static void audio_waitus(volatile uint32_t us)
 {
 	us *= (SystemCoreClock / 1000000) / 3;
@@ -175,10 +269,9 @@ void Audio::Clock(ClockMode clockmode)
 
 extern "C" uint32_t expectedPLL0AudioFreq;
 
-void Audio::I2SSetup()
+// The ADC is the clock master at every rate, the audio PLL is set once
+void Audio::PllSetup()
 {
-	CGU_ConfigPWR(CGU_PERIPHERAL_I2S, ENABLE);
-
 	// CGU_SetPLL0_Audio hangs/takes a very very long time to finish; skip it
 	//CGU_SetPLL0_Audio(12000000, 24576000, 0.75, 1.25);
 	// From user manual UM10503 page 191,
@@ -193,6 +286,11 @@ void Audio::I2SSetup()
 	CGU_EnableEntity(CGU_CLKSRC_PLL0_AUDIO, ENABLE);
 	CGU_EntityConnect(CGU_CLKSRC_PLL0_AUDIO, CGU_BASE_APB1);
 	CGU_UpdateClock();
+}
+
+void Audio::I2SSetup()
+{
+	CGU_ConfigPWR(CGU_PERIPHERAL_I2S, ENABLE);
 
 	I2S_CFG_Type config_i2s = {
 			.wordwidth = I2S_WORDWIDTH_32,
@@ -247,25 +345,129 @@ void Audio::I2SSetup()
 	I2S_SetBitRate(LPC_I2S0, 0, I2S_RX_MODE);
 	I2S_SetBitRate(LPC_I2S1, 0, I2S_RX_MODE);
 
-	// I2S0 interrupt will drive I2S1 also
-	I2S_IRQConfig(LPC_I2S0, I2S_RX_MODE, 2);
-	I2S_IRQCmd(LPC_I2S0, I2S_RX_MODE, ENABLE);
+	// Samples are moved by DMA, no I2S interrupts
+	I2S_IRQCmd(LPC_I2S0, I2S_RX_MODE, DISABLE);
 	I2S_IRQCmd(LPC_I2S0, I2S_TX_MODE, DISABLE);
 	I2S_IRQCmd(LPC_I2S1, I2S_RX_MODE, DISABLE);
 	I2S_IRQCmd(LPC_I2S1, I2S_TX_MODE, DISABLE);
 
-	NVIC_SetPriority(I2S0_IRQn, 0);
-	//NVIC_SetPriority(I2S1_IRQn, 0);
-
-	NVIC_EnableIRQ(I2S0_IRQn);
-	//NVIC_EnableIRQ(I2S1_IRQn);
+	DmaSetup();
 
 	// Setup done
 
 	I2S_Start(LPC_I2S0);
 	I2S_Start(LPC_I2S1);
+}
+
+// I2S0 RX, I2S1 RX and I2S0 TX each run a linked list over two blocks.
+// The RX channels interrupt at the end of every block.
+void Audio::DmaSetup()
+{
+	LPC_CCU1->CLK_M4_DMA_CFG |= CCU1_CLK_M4_DMA_CFG_RUN_Msk;
+	while(!(LPC_CCU1->CLK_M4_DMA_STAT & CCU1_CLK_M4_DMA_STAT_RUN_Msk));
+
+	LPC_GPDMA->CONFIG = 1;
+	LPC_GPDMA->INTTCCLEAR = 0xFF;
+	LPC_GPDMA->INTERRCLR = 0xFF;
+
+	// 2 bits per request line
+	uint32_t dmamux = LPC_CREG->DMAMUX;
+	dmamux &= ~((3 << (2*I2S0RXPERIPHERAL)) | (3 << (2*I2S0TXPERIPHERAL)) | (3 << (2*I2S1RXPERIPHERAL)));
+	dmamux |= (1 << (2*I2S0RXPERIPHERAL)) | (1 << (2*I2S0TXPERIPHERAL)) | (2 << (2*I2S1RXPERIPHERAL));
+	LPC_CREG->DMAMUX = dmamux;
+
+	memset(txbuffer, 0, sizeof(txbuffer));
+	rx0blocks = 0;
+	rx1blocks = 0;
+	processedblocks = 0;
+
+	// peripherals on master 0, memory on master 1
+	const uint32_t rxcontrol = AUDIOBLOCKWORDS
+			| DMA_CONTROL_SBSIZE_4 | DMA_CONTROL_DBSIZE_4
+			| DMA_CONTROL_SWIDTH_32 | DMA_CONTROL_DWIDTH_32
+			| DMA_CONTROL_D_MASTER1 | DMA_CONTROL_DI | DMA_CONTROL_I;
+	const uint32_t txcontrol = AUDIOBLOCKWORDS
+			| DMA_CONTROL_SBSIZE_4 | DMA_CONTROL_DBSIZE_4
+			| DMA_CONTROL_SWIDTH_32 | DMA_CONTROL_DWIDTH_32
+			| DMA_CONTROL_S_MASTER1 | DMA_CONTROL_SI;
+
+	uint32_t rx0fifo = uint32_t(&LPC_I2S0->RXFIFO);
+	uint32_t rx1fifo = uint32_t(&LPC_I2S1->RXFIFO);
+	uint32_t tx0fifo = uint32_t(&LPC_I2S0->TXFIFO);
+
+	dmapingpong(RX0CHANNEL, rx0lli, rx0fifo, rx0fifo, uint32_t(rx0buffer[0]), uint32_t(rx0buffer[1]), rxcontrol,
+			DMA_CONFIG_P2M | (I2S0RXPERIPHERAL << 1) | DMA_CONFIG_IE | DMA_CONFIG_ITC);
+	dmapingpong(RX1CHANNEL, rx1lli, rx1fifo, rx1fifo, uint32_t(rx1buffer[0]), uint32_t(rx1buffer[1]), rxcontrol,
+			DMA_CONFIG_P2M | (I2S1RXPERIPHERAL << 1) | DMA_CONFIG_IE | DMA_CONFIG_ITC);
+	dmapingpong(TX0CHANNEL, txlli, uint32_t(txbuffer[0]), uint32_t(txbuffer[1]), tx0fifo, tx0fifo, txcontrol,
+			DMA_CONFIG_M2P | (I2S0TXPERIPHERAL << 6));
+
+	I2S_DMAConf_Type rxdma = {
+			.DMAIndex = I2S_DMA_1,
+			.depth = I2SDMADEPTH,
+			.Reserved0 = {0, 0}
+	};
+	I2S_DMAConf_Type txdma = {
+			.DMAIndex = I2S_DMA_2,
+			.depth = I2SDMADEPTH,
+			.Reserved0 = {0, 0}
+	};
+	I2S_DMAConfig(LPC_I2S0, &rxdma, I2S_RX_MODE);
+	I2S_DMAConfig(LPC_I2S1, &rxdma, I2S_RX_MODE);
+	I2S_DMAConfig(LPC_I2S0, &txdma, I2S_TX_MODE);
+	I2S_DMACmd(LPC_I2S0, I2S_DMA_1, I2S_RX_MODE, ENABLE);
+	I2S_DMACmd(LPC_I2S1, I2S_DMA_1, I2S_RX_MODE, ENABLE);
+	I2S_DMACmd(LPC_I2S0, I2S_DMA_2, I2S_TX_MODE, ENABLE);
+
+	dmachannel(TX0CHANNEL)->CONFIG |= DMA_CONFIG_E;
+	dmachannel(RX1CHANNEL)->CONFIG |= DMA_CONFIG_E;
+	dmachannel(RX0CHANNEL)->CONFIG |= DMA_CONFIG_E;
+
+	NVIC_SetPriority(DMA_IRQn, 0);
+	NVIC_ClearPendingIRQ(DMA_IRQn);
+	NVIC_EnableIRQ(DMA_IRQn);
+}
 
-	NVIC_ClearPendingIRQ(I2S0_IRQn);
+void Audio::DmaStop()
+{
+	NVIC_DisableIRQ(DMA_IRQn);
+
+	dmachannel(RX0CHANNEL)->CONFIG &= ~DMA_CONFIG_E;
+	dmachannel(RX1CHANNEL)->CONFIG &= ~DMA_CONFIG_E;
+	dmachannel(TX0CHANNEL)->CONFIG &= ~DMA_CONFIG_E;
+
+	LPC_GPDMA->INTTCCLEAR = 0xFF;
+	LPC_GPDMA->INTERRCLR = 0xFF;
+	NVIC_ClearPendingIRQ(DMA_IRQn);
+}
+
+// I2S0 and I2S1 run in sync, so a block is ready when both RX channels
+// have finished it. The output block that was just sent is refilled,
+// one block ahead of the DMA.
+bool Audio::NextBlock(AudioBlock& block)
+{
+	uint32_t done = LPC_GPDMA->INTTCSTAT;
+	LPC_GPDMA->INTTCCLEAR = done;
+	LPC_GPDMA->INTERRCLR = LPC_GPDMA->INTERRSTAT;
+
+	if (done & (1 << RX0CHANNEL)) {
+		rx0blocks++;
+	}
+	if (done & (1 << RX1CHANNEL)) {
+		rx1blocks++;
+	}
+
+	if (int32_t(rx0blocks - processedblocks) <= 0 || int32_t(rx1blocks - processedblocks) <= 0) {
+		return false;
+	}
+
+	int buffer = processedblocks & 1;
+	block.in0 = rx0buffer[buffer];
+	block.in1 = rx1buffer[buffer];
+	block.out = txbuffer[buffer];
+
+	processedblocks++;
+	return true;
 }
 
 void Audio::AdcEnable()
@@ -302,16 +504,56 @@ void Audio::Init()
 	AdcReset();
 	DacReset();
 	Clock(AUDIO_CLOCK_48000);
+	PllSetup();
 	I2SSetup();
 
 	audio_waitus(100);
 
-	// feed the dac
-	while (((LPC_I2S0->STATE >> 16) & 0xF) < 8) {
-		LPC_I2S0->TXFIFO = 0.0;
-		LPC_I2S0->TXFIFO = 0.0;
+	// the dac is fed by TX DMA from here on
+
+	AdcEnable();
+	DacEnable();
+}
+
+// Restart the converters and both interfaces at another rate. Input and
+// output stop for the switch, false if the rate is unsupported or
+// already set.
+bool Audio::SetSampleRate(int samplerate)
+{
+	ClockMode clockmode;
+	switch (samplerate) {
+	case 48000:
+		clockmode = AUDIO_CLOCK_48000;
+		break;
+	case 96000:
+		clockmode = AUDIO_CLOCK_96000;
+		break;
+	case 192000:
+		clockmode = AUDIO_CLOCK_192000;
+		break;
+	default:
+		return false;
+	}
+
+	if (clockmode == _clockmode) {
+		return false;
 	}
 
+	DmaStop();
+	I2S_Stop(LPC_I2S0, I2S_TX_MODE);
+	I2S_Stop(LPC_I2S0, I2S_RX_MODE);
+	I2S_Stop(LPC_I2S1, I2S_RX_MODE);
+
+	// the clock select pins are sampled out of reset
+	AdcReset();
+	DacReset();
+	Clock(clockmode);
+	I2SSetup();
+
+	audio_waitus(100);
+
 	AdcEnable();
 	DacEnable();
+
+	return true;
 }
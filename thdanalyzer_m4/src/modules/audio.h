@@ -1,9 +1,28 @@
 #pragma once
 
+#include <stdint.h>
+
+// Frames moved by DMA between block interrupts
+#define AUDIOBLOCKFRAMES 32
+// I2S words in a block, left and right interleaved
+#define AUDIOBLOCKWORDS (2*AUDIOBLOCKFRAMES)
+
+// One block of I2S0 and I2S1 input, and the output block to fill
+struct AudioBlock
+{
+	const int32_t *in0;
+	const int32_t *in1;
+	int32_t *out;
+};
+
 class Audio
 {
 public:
 	void Init();
+	bool SetSampleRate(int samplerate);
+
+	// Next received block, called from DMA_IRQHandler until it returns false
+	bool NextBlock(AudioBlock& block);
 
 	int SampleRate() const
 	{
@@ -39,7 +58,10 @@ private:
 	void AdcReset();
 	void DacReset();
 
+	void PllSetup();
 	void I2SSetup();
+	void DmaSetup();
+	void DmaStop();
 	void AdcEnable();
 	void DacEnable();
 
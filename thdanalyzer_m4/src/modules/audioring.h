@@ -3,9 +3,31 @@
 
 #include "../emc_setup.h"
 #include "../lib/RingBuffer.h"
+#include "../common/sharedtypes.h"
 
-#define INPUTRINGLEN ((14*1048576)/4)
 typedef dsp::RingBufferMemory<int32_t, INPUTRINGLEN, SDRAM_BASE_ADDR> InputRing;
 extern InputRing inputRing;
 
+// Running sums of both input channels at every block boundary of the
+// ring, kept by the writer so readers get the mean of a range without
+// a pass over it. Between the averaging and window memory.
+#define INPUTSUMMEM (SDRAM_BASE_ADDR + 13*1048576 + 512*1024)
+// ring samples per entry, one audio block
+#define INPUTSUMBLOCK 64
+#define INPUTSUMENTRIES 32768
+
+struct InputSum
+{
+	// all samples before the boundary
+	int64_t signal;
+	int64_t filtered;
+};
+
+// entry for the block boundary at ring position
+inline InputSum& inputsum(uint64_t position)
+{
+	InputSum *sums = reinterpret_cast<InputSum*>(INPUTSUMMEM);
+	return sums[(position / INPUTSUMBLOCK) & (INPUTSUMENTRIES-1)];
+}
+
 #endif /* AUDIORING_H_ */
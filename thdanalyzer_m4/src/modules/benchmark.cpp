@@ -0,0 +1,172 @@
+#ifdef __USE_CMSIS
+#include "LPC43xx.h"
+#endif
+
+#include <math.h>
+
+#include "benchmark.h"
+#include "analyzer.h"
+#include "filter.h"
+
+#include "../lib/fft.h"
+#include "../lib/goertzel.h"
+#include "../lib/CycleCounter.h"
+
+Benchmark benchmark;
+
+namespace {
+
+	const int FilterBenchmarkSize = 1024;
+
+	void FillTestSignal(int32_t *samples, int size)
+	{
+		for (int i = 0; i < size; i++) {
+			samples[i] = int32_t(1.0e9f * sinf(float(i) * 0.1f));
+		}
+	}
+
+	void FillTestSignal(float *re, float *im, int size)
+	{
+		for (int i = 0; i < size; i++) {
+			re[i] = sinf(float(i) * 0.1f) + 0.001f * sinf(float(i) * 0.3f);
+			im[i] = 0;
+		}
+	}
+
+}
+
+void Benchmark::Add(const char* name, int size, uint32_t cycles)
+{
+	if (_numresults >= MaxResults) {
+		return;
+	}
+
+	BenchmarkResult& result = _results[_numresults++];
+	result.name = name;
+	result.size = size;
+	result.cycles = cycles;
+}
+
+uint32_t Benchmark::TimeFft(FftFunction function, int sizelog2)
+{
+	float *fftmem = (float*)FFTMEM;
+	float *re = &fftmem[0*MAXFFTSIZE];
+	float *im = &fftmem[1*MAXFFTSIZE];
+
+	FillTestSignal(re, im, 1 << sizelog2);
+
+	CycleCounter counter;
+	function(re, im, sizelog2-1);
+	return counter.Elapsed();
+}
+
+uint32_t Benchmark::TimeFftFourStep(int sizelog2)
+{
+	float *fftmem = (float*)FFTMEM;
+	float *re = &fftmem[0*MAXFFTSIZE];
+	float *im = &fftmem[1*MAXFFTSIZE];
+	float *outre = &fftmem[2*MAXFFTSIZE];
+	float *outim = &fftmem[3*MAXFFTSIZE];
+
+	FillTestSignal(re, im, 1 << sizelog2);
+
+	CycleCounter counter;
+	fft_fourstep(re, im, outre, outim, sizelog2-1, fftwork, FFTWORKSIZE);
+	return counter.Elapsed();
+}
+
+uint32_t Benchmark::TimeGoertzel(int sizelog2, int numbins)
+{
+	float *fftmem = (float*)FFTMEM;
+	float *re = &fftmem[0*MAXFFTSIZE];
+	float *im = &fftmem[1*MAXFFTSIZE];
+	int bins[HARMONICBANKMAXBINS];
+	float power[HARMONICBANKMAXBINS];
+
+	FillTestSignal(re, im, 1 << sizelog2);
+	for (int i = 0; i < numbins; i++) {
+		bins[i] = 100 + 7 * i;
+	}
+
+	CycleCounter counter;
+	goertzel_bank(re, 1 << sizelog2, bins, numbins, power);
+	return counter.Elapsed();
+}
+
+// Three cascaded notch sections run one sample at a time, as the old
+// per-sample I2S interrupt did
+uint32_t Benchmark::TimeFilter()
+{
+	int32_t *samples = (int32_t*)FFTMEM;
+	FilterParameters params = PrecalculateFilter(1000.0f / 48000.0f);
+	FilterState state1, state2, state3;
+
+	FillTestSignal(samples, FilterBenchmarkSize);
+
+	CycleCounter counter;
+	for (int i = 0; i < FilterBenchmarkSize; i++) {
+		int32_t filtered1 = Filter(samples[i], state1, params);
+		int32_t filtered2 = Filter(filtered1, state2, params);
+		samples[i] = Filter(filtered2, state3, params);
+	}
+	return counter.Elapsed();
+}
+
+uint32_t Benchmark::TimeFilterBlock(FilterBlockFunction function)
+{
+	int32_t *samples = (int32_t*)FFTMEM;
+	FilterParameters params = PrecalculateFilter(1000.0f / 48000.0f);
+	FilterState state1, state2, state3;
+
+	FillTestSignal(samples, FilterBenchmarkSize);
+
+	CycleCounter counter;
+	function(samples, samples, FilterBenchmarkSize, state1, params);
+	function(samples, samples, FilterBenchmarkSize, state2, params);
+	function(samples, samples, FilterBenchmarkSize, state3, params);
+	return counter.Elapsed();
+}
+
+void Benchmark::RunFft()
+{
+	for (int sizelog2 = 12; sizelog2 <= MAXFFTSIZELOG2; sizelog2 += 2) {
+		Add("fft_radix2", 1 << sizelog2, TimeFft(fft_radix2, sizelog2));
+		Add("fft", 1 << sizelog2, TimeFft(fft, sizelog2));
+	}
+}
+
+void Benchmark::RunFftFourStep()
+{
+	for (int sizelog2 = 14; sizelog2 <= MAXFFTSIZELOG2; sizelog2++) {
+		Add("fft", 1 << sizelog2, TimeFft(fft, sizelog2));
+		Add("fft_fourstep", 1 << sizelog2, TimeFftFourStep(sizelog2));
+	}
+}
+
+// Calibrates the FFT and Goertzel costs used by Analyzer::HarmonicBankCheaper
+void Benchmark::RunGoertzel()
+{
+	for (int sizelog2 = 12; sizelog2 <= MAXFFTSIZELOG2; sizelog2 += 2) {
+		Add("goertzel_bank x16", 1 << sizelog2, TimeGoertzel(sizelog2, 16));
+	}
+}
+
+// Cycles per sample are cycles / size
+void Benchmark::RunFilter()
+{
+	Add("Filter x3", FilterBenchmarkSize, TimeFilter());
+	Add("FilterBlockReference x3", FilterBenchmarkSize, TimeFilterBlock(FilterBlockReference));
+	Add("FilterBlockDsp x3", FilterBenchmarkSize, TimeFilterBlock(FilterBlockDsp));
+	Add("FilterBlockFloat x3", FilterBenchmarkSize, TimeFilterBlock(FilterBlockFloat));
+}
+
+void Benchmark::Run()
+{
+	CycleCounter::Enable();
+	_numresults = 0;
+
+	RunFft();
+	RunFftFourStep();
+	RunGoertzel();
+	RunFilter();
+}
@@ -0,0 +1,49 @@
+#ifndef BENCHMARK_H_
+#define BENCHMARK_H_
+
+#include <stdint.h>
+
+#include "filter.h"
+
+// Boot time cycle counts of the processing kernels.
+// Enabled with ANALYZER_BENCHMARK, results are read out with the debugger.
+struct BenchmarkResult
+{
+	const char* name;
+	int size;
+	uint32_t cycles;
+};
+
+class Benchmark
+{
+public:
+	void Run();
+
+	int NumResults() const { return _numresults; }
+	const BenchmarkResult& Result(int index) const { return _results[index]; }
+
+private:
+	typedef void (*FftFunction)(float *re, float *im, int m);
+	typedef void (*FilterBlockFunction)(const int32_t *in, int32_t *out, int n, FilterState& state, const FilterParameters& params);
+
+	void Add(const char* name, int size, uint32_t cycles);
+	uint32_t TimeFft(FftFunction function, int sizelog2);
+	uint32_t TimeFftFourStep(int sizelog2);
+	uint32_t TimeGoertzel(int sizelog2, int numbins);
+	uint32_t TimeFilter();
+	uint32_t TimeFilterBlock(FilterBlockFunction function);
+
+	void RunFft();
+	void RunFftFourStep();
+	void RunGoertzel();
+	void RunFilter();
+
+	enum { MaxResults = 32 };
+
+	BenchmarkResult _results[MaxResults];
+	int _numresults;
+};
+
+extern Benchmark benchmark;
+
+#endif /* BENCHMARK_H_ */
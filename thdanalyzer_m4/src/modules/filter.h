@@ -3,25 +3,62 @@
 
 #include <stdint.h>
 
+// Block filter implementation, chosen at compile time
+#define FILTER_BLOCK_REFERENCE 0
+#define FILTER_BLOCK_DSP 1
+#define FILTER_BLOCK_FLOAT 2
+
+#ifndef FILTER_BLOCK_IMPL
+#define FILTER_BLOCK_IMPL FILTER_BLOCK_DSP
+#endif
+
 struct FilterParameters
 {
 	int32_t a1, a2, b0, b1, b2;
+	// same filter for the FPU implementation
+	float fa1, fa2, fb0, fb1, fb2;
 };
 
+// A state belongs to one implementation, FilterBlockDsp keeps
+// unscaled samples in x and y
 struct FilterState
 {
 	int64_t x1, x2;
 	int64_t y1, y2;
 
+	// rounding residue carried over by FilterBlockDsp
+	int32_t error;
+	// transposed direct form II state of FilterBlockFloat
+	float s1, s2;
+
 	FilterState() {
 		x1 = 0;
 		x2 = 0;
 		y1 = 0;
 		y2 = 0;
+		error = 0;
+		s1 = 0;
+		s2 = 0;
 	}
 };
 
 FilterParameters PrecalculateFilter(float f);
 int32_t Filter(int32_t in, FilterState& state, const FilterParameters& params);
 
+// Block versions, in and out may be the same buffer
+void FilterBlockReference(const int32_t *in, int32_t *out, int n, FilterState& state, const FilterParameters& params);
+void FilterBlockDsp(const int32_t *in, int32_t *out, int n, FilterState& state, const FilterParameters& params);
+void FilterBlockFloat(const int32_t *in, int32_t *out, int n, FilterState& state, const FilterParameters& params);
+
+inline void FilterBlock(const int32_t *in, int32_t *out, int n, FilterState& state, const FilterParameters& params)
+{
+#if FILTER_BLOCK_IMPL == FILTER_BLOCK_FLOAT
+	FilterBlockFloat(in, out, n, state, params);
+#elif FILTER_BLOCK_IMPL == FILTER_BLOCK_DSP
+	FilterBlockDsp(in, out, n, state, params);
+#else
+	FilterBlockReference(in, out, n, state, params);
+#endif
+}
+
 #endif /* FILTER_H_ */
@@ -2,6 +2,48 @@
 
 #include "oscillator.h"
 #include "audio.h"
+#include "../lib/multitone.h"
+
+// One loop is rendered while the interrupt plays the other
+static int nextloop = 0;
+
+// Frames in the longest loop holding a whole number of periods, 0 if none fits
+static int LoopLength(float ratio, int& periods)
+{
+	for (int p = 1; p <= OSCLOOPMAXFRAMES/2; p++) {
+		int length = int(p / ratio + 0.5f);
+		if (length > OSCLOOPMAXFRAMES) {
+			break;
+		}
+		if (fabsf(float(p) / float(length) - ratio) <= ratio * OSCLOOPTOLERANCE) {
+			int repeat = OSCLOOPMAXFRAMES / length;
+			periods = p * repeat;
+			return length * repeat;
+		}
+	}
+	return 0;
+}
+
+static void RenderLoop(int32_t *loop, int length, int periods, float scale)
+{
+	// exact phase from the integer position keeps the loop seamless
+	for (int i = 0; i < length; i++) {
+		int phase = int((int64_t(i) * periods) % length);
+		loop[i] = int32_t(scale * sinf(2.0f * 3.141592654f * float(phase) / float(length)));
+	}
+}
+
+// Peak output for a sine of leveldbu
+static float OutputLevel(float leveldbu)
+{
+	float levelscale = powf(10.0f, leveldbu * 0.05f);
+	return levelscale * 0.5f * 2.19089023f / 25.6f;
+}
+
+void InitOsc()
+{
+	multitone_init((void*)MULTITONEMEM, MULTITONEMEMSIZE);
+}
 
 OscillatorParameters PrecalculateOsc(float frequencyhz, float leveldbu)
 {
@@ -9,37 +51,93 @@ OscillatorParameters PrecalculateOsc(float frequencyhz, float leveldbu)
 
 	float sincoeff = 2.f*3.141592654f*frequencyhz/audio.SampleRateFloat()/2.0f;
 	result.e = 2.0f * sinf(sincoeff);
+	result.peak = 1.0f / sqrtf(1.0f - 0.25f * result.e * result.e);
 
-	float levelscale = powf(10.0f, leveldbu * 0.05f);
-	result.level = levelscale * 0.5f * 2.19089023f / 25.6f;
+	result.level = OutputLevel(leveldbu);
+
+	result.loop = 0;
+	result.looplength = 0;
+	int periods;
+	int length = LoopLength(frequencyhz / audio.SampleRateFloat(), periods);
+	if (length > 0) {
+		int32_t *loop = (int32_t*)OSCLOOPMEM + nextloop * OSCLOOPMAXFRAMES;
+		nextloop ^= 1;
+		RenderLoop(loop, length, periods, result.level * 2147483648.0f);
+		result.loop = loop;
+		result.looplength = length;
+	}
+
+	return result;
+}
+
+// One period of the multitone stimulus with the peak of a sine of leveldbu
+OscillatorParameters PrecalculateMultitone(float leveldbu)
+{
+	OscillatorParameters result;
+
+	result.e = 0.0f;
+	result.peak = 1.0f;
+	result.level = OutputLevel(leveldbu);
+
+	int32_t *loop = (int32_t*)OSCLOOPMEM + nextloop * OSCLOOPMAXFRAMES;
+	nextloop ^= 1;
+	multitone_render(loop, result.level * 2147483648.0f);
+	result.loop = loop;
+	result.looplength = MULTITONELENGTH;
 
 	return result;
 }
 
-int32_t Generator(OscillatorState& state, const OscillatorParameters& params, bool reset)
+// Next frames of output as (negative, positive) pairs
+void GeneratorBlock(OscillatorState& state, const OscillatorParameters& params, bool reset, int32_t *out, int frames, bool balanced)
 {
 	if (reset) {
-		// reset oscillator
-		state.yq = 1.0;
-		state.y = 0.0;
-		state.maxlevel = 0.5;
-		state.maxlevelinv = 2.0;
+		// reset oscillator, its peak is known from e
+		state.yq = 1.0f;
+		state.y = 0.0f;
+		state.maxlevel = params.peak;
+		state.gain = params.level * 2147483648.0f / params.peak;
+		state.loopposition = 0;
+	}
+
+	if (params.loop) {
+		int position = state.loopposition;
+		for (int i = 0; i < frames; i++) {
+			int32_t sample = params.loop[position];
+			if (++position == params.looplength) {
+				position = 0;
+			}
+
+			out[2*i] = balanced ? -sample : 0;
+			out[2*i+1] = sample;
+		}
+		state.loopposition = position;
+		return;
 	}
 
 	// iterate oscillator
 	float e_local = params.e;
-	float gain_local = params.level;
-	state.yq = state.yq - e_local*state.y;
-	state.y = e_local*state.yq + state.y;
+	float gain_local = state.gain;
+	float yq = state.yq;
+	float y = state.y;
+	float maxlevel = state.maxlevel;
+	for (int i = 0; i < frames; i++) {
+		yq = yq - e_local*y;
+		y = e_local*yq + y;
+		if (y > maxlevel) {
+			maxlevel = y;
+		}
 
-	if (state.y > state.maxlevel) {
-		state.maxlevel = state.y;
-		state.maxlevelinv = 1.0 / state.y;
+		int32_t sample = int32_t(y * gain_local);
+		out[2*i] = balanced ? -sample : 0;
+		out[2*i+1] = sample;
 	}
+	state.yq = yq;
+	state.y = y;
 
-	gain_local *= state.maxlevelinv;
-
-	// store results
-	return int32_t(state.y * gain_local * 2147483648.0);
+	// rounding drift renormalizes at most once per block
+	if (maxlevel > state.maxlevel) {
+		state.maxlevel = maxlevel;
+		state.gain = params.level * 2147483648.0f / maxlevel;
+	}
 }
-
@@ -2,11 +2,27 @@
 #define OSCILLATOR_H_
 
 #include <stdint.h>
+#include "../emc_setup.h"
+
+// Two loops in SDRAM between the averages and the zoom filter
+#define OSCLOOPMEM (SDRAM_BASE_ADDR + 13*1048576 + 320*1024)
+// Sine table of the multitone stimulus after them
+#define MULTITONEMEM (OSCLOOPMEM + 2*OSCLOOPMAXFRAMES*4)
+// Longest loop of whole periods, in frames
+#define OSCLOOPMAXFRAMES 4096
+// Largest relative frequency error accepted for a loop
+#define OSCLOOPTOLERANCE 1e-6f
 
 struct OscillatorParameters
 {
 	float e;
 	float level;
+	// peak of the unscaled oscillator for this e
+	float peak;
+
+	// whole periods rendered in advance, or 0 to iterate the oscillator
+	const int32_t *loop;
+	int looplength;
 };
 
 struct OscillatorState
@@ -14,10 +30,13 @@ struct OscillatorState
 	float y;
 	float yq;
 	float maxlevel;
-	float maxlevelinv;
+	float gain;
+	int loopposition;
 };
 
+void InitOsc();
 OscillatorParameters PrecalculateOsc(float frequencyhz, float leveldbu);
-int32_t Generator(OscillatorState& state, const OscillatorParameters& params, bool reset);
+OscillatorParameters PrecalculateMultitone(float leveldbu);
+void GeneratorBlock(OscillatorState& state, const OscillatorParameters& params, bool reset, int32_t *out, int frames, bool balanced);
 
 #endif /* OSCILLATOR_H_ */
@@ -6,6 +6,7 @@
 #include "audio.h"
 #include "common/sharedtypes.h"
 #include "lib/LocalMailbox.h"
+#include "lib/CycleCounter.h"
 
 Process process;
 
@@ -24,12 +25,20 @@ struct AudioIrqParameters
 AudioIrqParameters current_params;
 LocalMailbox<AudioIrqParameters> oscMailbox;
 
+// input frame, modulo the loop length, at which the loop was at its start
+volatile uint32_t loopanchor = 0;
+
 static AudioIrqParameters CalculateParameters(Process::GeneratorMode mode, float frequencyhz, float leveldbu, bool balancedio, float cv0, float cv1)
 {
 	AudioIrqParameters irqparams;
 
 	irqparams.mode = mode;
-	irqparams.osc = PrecalculateOsc(frequencyhz, leveldbu);
+	if (mode == Process::GeneratorModeMultitone) {
+		irqparams.osc = PrecalculateMultitone(leveldbu);
+	}
+	else {
+		irqparams.osc = PrecalculateOsc(frequencyhz, leveldbu);
+	}
 	irqparams.filter = PrecalculateFilter(frequencyhz/audio.SampleRateFloat());
 	irqparams.balancedio = balancedio;
 	irqparams.cv0 = cv0;
@@ -41,14 +50,38 @@ static AudioIrqParameters CalculateParameters(Process::GeneratorMode mode, float
 void Process::Init()
 {
 	// Prepare for first I2S interrupt
+	CycleCounter::Enable();
+	InitOsc();
+	(*inputIndex).reset();
+	InputSum zero = { 0, 0 };
+	inputsum(0) = zero;
+	AudioLoad load = { 0, 0, 0, 0, 0.0f };
+	audioLoad.Store(load);
 	SetParameters(GeneratorModeOscillator, 1000.0, 4.0, true, 0.0, 0.0);
 }
 
 void Process::SetParameters(GeneratorMode mode, float frequencyhz, float leveldbu, bool balancedio, float cv0, float cv1)
 {
+	// until the interrupt has taken the last parameters it may still be
+	// playing the loop buffer that is rendered next
+	while (!oscMailbox.CanWrite());
+
 	oscMailbox.Write(CalculateParameters(mode, frequencyhz, leveldbu, balancedio, cv0, cv1));
 }
 
+// Frames from the start of the playing loop to the input frame at ring
+// position, with the DMA buffering between output and input included.
+// The group delay of the converters is not, it stays in the measured phase.
+int Process::LoopOffset(uint64_t position) const
+{
+	int length = current_params.osc.looplength;
+	if (length == 0) {
+		return 0;
+	}
+
+	return int((position / 2 + length - loopanchor) % length);
+}
+
 int32_t DCLevel(float level)
 {
 	int32_t value = level * (2147483648.0 / 12.38);
@@ -59,63 +92,125 @@ int32_t DCLevel(float level)
 #include "modules/audioring.h"
 InputRing inputRing;
 
+InputSum inputsums;
+
 OscillatorState oscstate;
 FilterState filterstate;
 FilterState filterstate2;
 FilterState filterstate3;
 FilterState filterstate4;
 
-int32_t nextsample_pos = 0;
-int32_t nextsample_neg = 0;
-
-extern "C"
-void I2S0_IRQHandler(void)
+// One block of input to the ring and the next block of generator output
+static void ProcessBlock(const AudioBlock& block)
 {
-	LPC_I2S0->TXFIFO = nextsample_neg;
-	LPC_I2S0->TXFIFO = nextsample_pos;
-
-	// I2S0 and I2S1 run in sync, so we can check both here
-
-	int32_t in0_l = LPC_I2S0->RXFIFO;
-	int32_t in0_r = LPC_I2S0->RXFIFO;
-	int32_t in1_l = LPC_I2S1->RXFIFO;
-	int32_t in1_r = LPC_I2S1->RXFIFO;
-
-	int32_t average = (in0_l >> 2) + (in0_r >> 2) + (in1_l >> 2) + (in1_r >> 2);
-	// filter x2
-	int32_t filtered1 = Filter(average, filterstate, current_params.filter);
-	int32_t filtered2 = Filter(filtered1, filterstate2, current_params.filter);
-	int32_t filtered3 = Filter(filtered2, filterstate3, current_params.filter);
-	//int32_t filtered4 = Filter(filtered3, filterstate4, current_params.filter);
-	inputRing.insert(average);
-	inputRing.insert(filtered3);
-
-	if (inputRing.used() >= INPUTRINGLEN/2+16UL) {
-		inputRing.advance(16);
+	int32_t input[AUDIOBLOCKFRAMES];
+	int32_t filtered[AUDIOBLOCKFRAMES];
+
+	for (int i = 0; i < AUDIOBLOCKFRAMES; i++) {
+		int32_t in0_l = block.in0[2*i];
+		int32_t in0_r = block.in0[2*i+1];
+		int32_t in1_l = block.in1[2*i];
+		int32_t in1_r = block.in1[2*i+1];
+
+		input[i] = (in0_l >> 2) + (in0_r >> 2) + (in1_l >> 2) + (in1_r >> 2);
 	}
 
-	*oldestPtr = inputRing.oldestPtr();
-	*latestPtr = inputRing.latestPtr()+1;
+	// filter x3
+	FilterBlock(input, filtered, AUDIOBLOCKFRAMES, filterstate, current_params.filter);
+	FilterBlock(filtered, filtered, AUDIOBLOCKFRAMES, filterstate2, current_params.filter);
+	FilterBlock(filtered, filtered, AUDIOBLOCKFRAMES, filterstate3, current_params.filter);
+	//FilterBlock(filtered, filtered, AUDIOBLOCKFRAMES, filterstate4, current_params.filter);
+
+	int32_t interleaved[2*AUDIOBLOCKFRAMES];
+	int64_t signalsum = 0;
+	int64_t filteredsum = 0;
+	for (int i = 0; i < AUDIOBLOCKFRAMES; i++) {
+		interleaved[2*i] = input[i];
+		interleaved[2*i+1] = filtered[i];
+		signalsum += input[i];
+		filteredsum += filtered[i];
+	}
+	inputRing.insert(interleaved, 2*AUDIOBLOCKFRAMES);
 
-	bool reset = oscMailbox.Read(current_params);
+	inputsums.signal += signalsum;
+	inputsums.filtered += filteredsum;
+	inputsum(inputRing.written()) = inputsums;
 
-	// then generate next sample
-	if (current_params.mode == Process::GeneratorModeOscillator) {
-		nextsample_pos = Generator(oscstate, current_params.osc, reset);
+	if (inputRing.used() >= INPUTRINGLEN/2+2*AUDIOBLOCKFRAMES) {
+		inputRing.advance(2*AUDIOBLOCKFRAMES);
+	}
 
-		if (current_params.balancedio) {
-			nextsample_neg = -nextsample_pos;
-		}
-		else {
-			nextsample_neg = 0;
+	bool reset = oscMailbox.Read(current_params);
+
+	// then generate the next block, negative output first
+	int32_t *out = block.out;
+	if (current_params.mode == Process::GeneratorModeOscillator || current_params.mode == Process::GeneratorModeMultitone) {
+		GeneratorBlock(oscstate, current_params.osc, reset, out, AUDIOBLOCKFRAMES, current_params.balancedio);
+
+		// the DMA is playing the other buffer while the next input block
+		// comes in, this one goes out with the block after that
+		if (current_params.osc.loop) {
+			uint64_t length = current_params.osc.looplength;
+			uint64_t start = (oscstate.loopposition + length - AUDIOBLOCKFRAMES % length) % length;
+			uint64_t first = inputRing.written() / 2 + AUDIOBLOCKFRAMES;
+			loopanchor = uint32_t((first + length - start) % length);
 		}
 	}
 	else if (current_params.mode == Process::GeneratorModeDC) {
-		nextsample_pos = DCLevel(current_params.cv0);
-		nextsample_neg = DCLevel(current_params.cv1);
+		int32_t pos = DCLevel(current_params.cv0);
+		int32_t neg = DCLevel(current_params.cv1);
+		for (int i = 0; i < AUDIOBLOCKFRAMES; i++) {
+			out[2*i] = neg;
+			out[2*i+1] = pos;
+		}
 	}
 
 	if (reset) {
 		inputRing.clear();
 	}
+
+	// readers on both cores go by the published extent only
+	inputRing.publish(*inputIndex);
+}
+
+// Interrupt load over about a second of blocks
+static uint32_t loadcycles = 0;
+static uint32_t loadmaxcycles = 0;
+static int loadblocks = 0;
+
+static void AccountBlock(uint32_t cycles)
+{
+	loadcycles += cycles;
+	if (cycles > loadmaxcycles) {
+		loadmaxcycles = cycles;
+	}
+	loadblocks++;
+
+	int samplerate = audio.SampleRate();
+	if (loadblocks * AUDIOBLOCKFRAMES < samplerate) {
+		return;
+	}
+
+	AudioLoad load;
+	load._samplerate = samplerate;
+	load._budget = SystemCoreClock / samplerate;
+	load._cycles = loadcycles / (loadblocks * AUDIOBLOCKFRAMES);
+	load._maxcycles = loadmaxcycles / AUDIOBLOCKFRAMES;
+	load._headroom = 1.0f - float(load._maxcycles) / float(load._budget);
+	audioLoad.Store(load);
+
+	loadcycles = 0;
+	loadmaxcycles = 0;
+	loadblocks = 0;
+}
+
+extern "C"
+void DMA_IRQHandler(void)
+{
+	AudioBlock block;
+	while (audio.NextBlock(block)) {
+		CycleCounter counter;
+		ProcessBlock(block);
+		AccountBlock(counter.Elapsed());
+	}
 }
@@ -13,10 +13,12 @@ public:
 	enum GeneratorMode
 	{
 		GeneratorModeOscillator,
-		GeneratorModeDC
+		GeneratorModeDC,
+		GeneratorModeMultitone
 	};
 	void Init();
 	void SetParameters(GeneratorMode mode, float frequencyhz, float leveldbu, bool balancedio, float cv0, float cv1);
+	int LoopOffset(uint64_t position) const;
 };
 
 extern Process process;
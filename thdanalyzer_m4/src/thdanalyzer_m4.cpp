@@ -14,6 +14,7 @@
 #include "FreeRTOS.h"
 #include "task.h"
 #include "queue.h"
+#include "semphr.h"
 
 #ifdef __USE_CMSIS
 #include "LPC43xx.h"
@@ -45,15 +46,17 @@ void check_failed(uint8_t *file, uint32_t line)
 #include "common/sharedtypes.h"
 #include "modules/analyzer.h"
 #include "modules/process.h"
+#include "modules/benchmark.h"
 #include "lib/fft.h"
 
-uint8_t freertos_heap[0x8000];
+// Leaves room in the 40 kB local SRAM for the FFT work buffer
+uint8_t freertos_heap[0x4000];
 
 void init_freertos_heap()
 {
 	const HeapRegion_t xHeapRegions[] =
 	{
-	    { freertos_heap, 0x8000 },
+	    { freertos_heap, sizeof(freertos_heap) },
 	    { NULL, 0 } /* Terminates the array. */
 	};
 
@@ -76,7 +79,8 @@ void vApplicationStackOverflowHook(TaskHandle_t pxTask, char *pcTaskName)
 
 enum MainTaskEvent {
 	AnalyzerDone,
-	InterruptAnalyzer
+	AnalyzerCancelled,
+	M0Command
 };
 
 
@@ -84,58 +88,103 @@ Analyzer analyzer;
 
 GeneratorParameters params = GeneratorParameters(1000.0, 4.0, true, GeneratorParameters::OperationModeTHD, 0.0, 0.0);
 
-QueueHandle_t processingDoneQueue;
+// Main task waits on events, the analysis task on starts
+QueueHandle_t mainEventQueue;
+SemaphoreHandle_t analysisStart;
+
+// Ticks between ring checks while an analysis waits for input
+#define INPUTPOLLTICKS 1
 
 extern "C"
 void M0CORE_IRQHandler(void)
 {
 	BaseType_t xHigherPriorityTaskWoken = pdFALSE;
 
-	MainTaskEvent msg = InterruptAnalyzer;
-	xQueueSendToBackFromISR(processingDoneQueue, &msg, &xHigherPriorityTaskWoken);
+	// the M0 wrote a mailbox
+	MainTaskEvent msg = M0Command;
+	xQueueSendToBackFromISR(mainEventQueue, &msg, &xHigherPriorityTaskWoken);
 
 	// clear event interrupt
 	LPC_CREG->M0TXEVENT = 0x0;
 
-	if (xHigherPriorityTaskWoken != pdFALSE) {
-		taskYIELD();
-	}
+	portYIELD_FROM_ISR(xHigherPriorityTaskWoken);
 }
 
-void vProcessTask(void* pvParameters)
+// Analysis task, runs one analysis per start for as long as the device
+void vAnalysisTask(void* pvParameters)
 {
-	analyzer.Process(params._frequency, params._analysismode);
+	while(1) {
+		xSemaphoreTake(analysisStart, portMAX_DELAY);
 
-	// ack process to main task
-	MainTaskEvent result = AnalyzerDone;
-	xQueueSend(processingDoneQueue, &result, 0);
+		bool done = analyzer.Process(params._frequency, params._analysismode);
 
-	vTaskSuspend(NULL);
+		// ack process to main task
+		MainTaskEvent result = done ? AnalyzerDone : AnalyzerCancelled;
+		xQueueSend(mainEventQueue, &result, portMAX_DELAY);
+	}
 }
 
-// Main task
+// Main task. The M0 keeps no more commands and acks outstanding than
+// the queues hold, so the acks written here always fit.
 void vMainTask(void* pvParameters)
 {
-	TaskHandle_t analyzerTaskHandle = NULL;
+	bool running = false;
 	bool needToStart = false;
+	// look at the mailboxes once before waiting for the M0
+	TickType_t wait = 0;
 
 	while(1) {
-		if (commandMailbox.Read(params)) {
-			Process::GeneratorMode mode = Process::GeneratorModeOscillator;
-			if (params._analysismode == GeneratorParameters::OperationModeDCVoltageControl) {
-				mode = Process::GeneratorModeDC;
+		MainTaskEvent msg;
+		if (xQueueReceive(mainEventQueue, &msg, wait) == pdTRUE) {
+			if (msg == AnalyzerDone) {
+				running = false;
+				analysisAckMailbox.Write(true);
+			}
+			else if (msg == AnalyzerCancelled) {
+				// the M0 still waits for a result, run again once the new
+				// configuration is in
+				running = false;
+				needToStart = true;
+				analyzer.ClearResults();
 			}
-			process.SetParameters(mode, params._frequency, params._level, params._balancedio, params._cv0, params._cv1);
-			ackMailbox.Write(true);
-			analyzer.Refresh();
 		}
 
-		if (analyzerTaskHandle == NULL) {
-				 analyzer.Update(params._frequency);
-    	}
+		if (running) {
+			// a new configuration stops the analysis for the old one, and
+			// is taken once the analysis task has let go of params
+			if (commandMailbox.CanRead()) {
+				analyzer.Cancel();
+			}
+		}
+		else {
+			if (commandMailbox.Read(params)) {
+				// new rate before the filter and oscillator are calculated for it
+				audio.SetSampleRate(params._samplerate);
+
+				// coherent analysis moves the generator onto an FFT bin
+				analyzer.Configure(params);
+				params._frequency = analyzer.GeneratorFrequency(params._frequency);
+
+				Process::GeneratorMode mode = Process::GeneratorModeOscillator;
+				if (params._analysismode == GeneratorParameters::OperationModeDCVoltageControl) {
+					mode = Process::GeneratorModeDC;
+				}
+				else if (params._analysismode == GeneratorParameters::OperationModeFrequencyResponse) {
+					mode = Process::GeneratorModeMultitone;
+				}
+				process.SetParameters(mode, params._frequency, params._level, params._balancedio, params._cv0, params._cv1);
+				GeneratorAck ack;
+				ack._frequency = params._frequency;
+				ack._fftsize = analyzer.CoherentFftSize();
+				ackMailbox.Write(ack);
+				analyzer.Refresh();
+			}
+
+			analyzer.Update(params._frequency);
+		}
 
 		AnalysisCommand analysiscmd;
-		if (analysisCommandMailbox.Read(analysiscmd)) {
+		while (analysisCommandMailbox.Read(analysiscmd)) {
 			if (analysiscmd.commandType == AnalysisCommand::BLOCK) {
 				needToStart = true;
 			}
@@ -143,38 +192,23 @@ void vMainTask(void* pvParameters)
 				analyzer.Finish();
 				analysisAckMailbox.Write(true);
 			}
-    	}
-
-		if (needToStart && analyzer.CanProcess()) {
-			xQueueReset(processingDoneQueue);
-			// start process task
-			(void) xTaskCreate(vProcessTask, "process", 1024, NULL, 1, &analyzerTaskHandle);
-			if (analyzerTaskHandle != NULL) {
-				needToStart = false;
-			}
 		}
 
-		if (analyzerTaskHandle != NULL) {
-			// wait
-			MainTaskEvent msg;
-			if (xQueueReceive(processingDoneQueue, &msg, 0) == pdTRUE)
-			{
-				if (msg == InterruptAnalyzer) {
-					// need to stop the analyzer
-					vTaskSuspend(analyzerTaskHandle);
-				}
-
-				vTaskDelete(analyzerTaskHandle);
-				analyzerTaskHandle = NULL;
-				
-				xQueueReset(processingDoneQueue);
-
-				analysisAckMailbox.Write(true);
-			}
+		if (needToStart && !running && analyzer.CanProcess()) {
+			analyzer.Capture();
+			running = true;
+			needToStart = false;
+			xSemaphoreGive(analysisStart);
 		}
 
-		// Delay instead of yielding, so that idle process can sweep out deleted tasks
-		vTaskDelay(5);
+		// queued configurations are taken one per pass, the ring is only
+		// watched while an analysis waits for input
+		if (!running && commandMailbox.CanRead()) {
+			wait = 0;
+		}
+		else {
+			wait = needToStart && !running ? INPUTPOLLTICKS : portMAX_DELAY;
+		}
 	}
 }
 
@@ -212,6 +246,11 @@ void init_sdram()
 
 int main(void)
 {
+	// the slot chain must not run past the shared SRAM
+	if (!SharedMemoryFits()) {
+		while(1);
+	}
+
 	set_clock_frequency();
 
     set_fpu_configuration();
@@ -220,15 +259,21 @@ int main(void)
 
     start_coprocessors();
 
-    // Spawn main task
+    // Spawn main task, and the analysis task once and for all
     xTaskCreate(vMainTask, "main", 256, NULL, 2, NULL);
-	processingDoneQueue = xQueueCreate(32, sizeof(MainTaskEvent));
+    xTaskCreate(vAnalysisTask, "process", 1024, NULL, 1, NULL);
+	mainEventQueue = xQueueCreate(32, sizeof(MainTaskEvent));
+	analysisStart = xSemaphoreCreateBinary();
 
     init_sdram();
 
 	analyzer.Init();
 	process.Init();
 
+#ifdef ANALYZER_BENCHMARK
+	benchmark.Run();
+#endif
+
 	__disable_irq();
 
 	// Enable M0 interrupt
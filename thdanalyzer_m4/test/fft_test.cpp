@@ -0,0 +1,84 @@
+// Host test of the real-pair transform against the complex transforms:
+// two real signals through fft_real_pair must give the spectra fft()
+// and fft_radix2() give for each of them with a zero imaginary part.
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+
+#include "fft.h"
+
+#define MAXM 15
+
+namespace {
+
+	// Largest bin error relative to the largest reference bin
+	double relerror(const std::vector<float>& re, const std::vector<float>& im,
+			const std::vector<float>& refre, const std::vector<float>& refim, int n)
+	{
+		double maxerror = 0;
+		double maxref = 0;
+		for (int i=0;i<n;i++) {
+			maxerror = fmax(maxerror, hypot(re[i] - refre[i], im[i] - refim[i]));
+			maxref = fmax(maxref, hypot(refre[i], refim[i]));
+		}
+		return maxref > 0 ? maxerror / maxref : maxerror;
+	}
+
+}
+
+int main()
+{
+	std::vector<char> tables(fft_tablesize(MAXM));
+	fft_init(&tables[0], int(tables.size()), MAXM);
+
+	srand(1);
+	int failures = 0;
+
+	for (int m=3;m<=MAXM;m++) {
+		int n = 2 << m;
+		std::vector<float> x(n), y(n);
+
+		// a tone off the bin grid plus noise in one, noise alone in the other
+		for (int i=0;i<n;i++) {
+			float noise0 = float(rand()) / RAND_MAX - 0.5f;
+			float noise1 = float(rand()) / RAND_MAX - 0.5f;
+			x[i] = sinf(2*M_PI * 3.3f * i / n) + 1e-3f * noise0;
+			y[i] = noise1;
+		}
+
+		std::vector<float> re1(x), im1(n), re2(y), im2(n);
+		fft_real_pair(&re1[0], &im1[0], &re2[0], &im2[0], m);
+
+		std::vector<float> xre(x), xim(n, 0.0f), yre(y), yim(n, 0.0f);
+		fft(&xre[0], &xim[0], m);
+		fft(&yre[0], &yim[0], m);
+
+		std::vector<float> xre2(x), xim2(n, 0.0f), yre2(y), yim2(n, 0.0f);
+		fft_radix2(&xre2[0], &xim2[0], m);
+		fft_radix2(&yre2[0], &yim2[0], m);
+
+		// float rounding grows with the number of stages, and the
+		// recursive twiddles of fft_radix2 drift with the size
+		double bound = 5e-7 * (m + 1);
+		double radix2bound = 1e-6 + 1e-8 * n;
+		double errors[4] = {
+			relerror(re1, im1, xre, xim, n),
+			relerror(re2, im2, yre, yim, n),
+			relerror(re1, im1, xre2, xim2, n),
+			relerror(re2, im2, yre2, yim2, n),
+		};
+
+		bool ok = errors[0] <= bound && errors[1] <= bound
+			&& errors[2] <= radix2bound && errors[3] <= radix2bound;
+		if (!ok) {
+			failures++;
+		}
+
+		printf("%6d  fft %.2e %.2e  radix2 %.2e %.2e  %s\n", n,
+				errors[0], errors[1], errors[2], errors[3], ok ? "ok" : "FAIL");
+	}
+
+	return failures ? 1 : 0;
+}
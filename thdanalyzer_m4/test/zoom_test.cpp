@@ -0,0 +1,70 @@
+// Host test of the zoom decimator: a tone in the band comes out of the
+// complex baseband at half its amplitude, tones that fold into the band
+// from 1.1 and 1.2 times the decimated rate come out far below it.
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <vector>
+
+#include "zoom.h"
+
+#define FACTORLOG2 4
+#define INPUTS (4096 << FACTORLOG2)
+#define AMPLITUDE 1073741824.0
+
+namespace {
+
+	// rms of the complex output for a tone at frequency times the
+	// decimated rate, relative to the tone amplitude in dB
+	double level(double frequency)
+	{
+		int factor = 1 << FACTORLOG2;
+		double step = frequency / factor;
+
+		std::vector<int32_t> in(2*INPUTS);
+		for (int i=0;i<INPUTS;i++) {
+			int32_t x = int32_t(AMPLITUDE * sin(2*M_PI * step * i));
+			in[2*i] = x;
+			in[2*i+1] = x;
+		}
+
+		int outputs = INPUTS / factor;
+		std::vector<float> re0(outputs), im0(outputs), re1(outputs), im1(outputs);
+
+		ZoomState state;
+		zoom_start(state, FACTORLOG2, 0.25 / factor, 0, 0);
+		zoom_run(state, &in[0], INPUTS, &re0[0], &im0[0], &re1[0], &im1[0]);
+
+		double sum = 0;
+		for (int m=0;m<state.outputs;m++) {
+			sum += double(re0[m]) * re0[m] + double(im0[m]) * im0[m];
+		}
+
+		return 10*log10(sum / state.outputs) - 20*log10(AMPLITUDE);
+	}
+
+}
+
+int main()
+{
+	std::vector<float> filtermem(ZOOMTAPSPERPHASE << ZOOMMAXFACTORLOG2);
+	zoom_init(&filtermem[0], int(filtermem.size() * sizeof(float)));
+
+	// the band is DC to half the decimated rate, the negative frequency
+	// of a tone at 0.3 is mixed to -0.55 and filtered out
+	double inband = level(0.3);
+	double fold1 = level(1.1);
+	double fold2 = level(1.2);
+
+	printf("in band %.3f dB\n", inband);
+	printf("from 1.1 x rate %.1f dB, 1.2 x rate %.1f dB\n", fold1, fold2);
+
+	// half amplitude in the complex baseband, and the stopband of the
+	// Blackman-Harris windowed sinc with float sums
+	bool ok = fabs(inband - 20*log10(0.5)) < 0.01
+		&& fold1 - inband < -120 && fold2 - inband < -120;
+
+	printf("%s\n", ok ? "ok" : "FAIL");
+	return ok ? 0 : 1;
+}